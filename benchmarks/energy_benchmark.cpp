@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "body_integrator.hpp"
+
+/*
+Benchmark of the integrators, single-threaded so the figures are per core
+Every body is held to the origin by its own spring, F = -k * x, so the exact motion keeps its energy
+Energy drift is reported against the cost per body-step at several time steps
+*/
+
+constexpr std::size_t BODY_COUNT = 4096;
+
+// Simulated time of the drift measurement, in seconds
+constexpr float DURATION = 60.0f;
+
+/*
+Create bodies at random positions and velocities
+@param count: Number of bodies
+*/
+static BodyBatch make_bodies(const std::size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> mass(0.5f, 5.0f);
+    const auto vector = [&value, &rng]()
+    {
+        return glm::vec3(value(rng), value(rng), value(rng));
+    };
+
+    BodyBatch bodies;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        bodies.push_back(vector(), vector(), glm::vec3(0.0f), 1.0f / mass(rng), glm::vec3(0.0f), glm::vec3(0.0f),
+                         glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    }
+    return bodies;
+}
+
+/*
+Stiffness of the spring of each body, periods between about 1 and 4 seconds
+@param bodies: Bodies to create springs for
+*/
+static std::vector<float> make_stiffnesses(const BodyBatch &bodies)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> period(1.0f, 4.0f);
+
+    std::vector<float> stiffnesses(bodies.size());
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        const float omega = 2.0f * 3.14159265f / period(rng);
+        stiffnesses[i] = omega * omega / bodies.inv_mass[i];
+    }
+    return stiffnesses;
+}
+
+/*
+Total energy of the bodies, kinetic and elastic, in double so the sum adds no error of its own
+@param bodies: Bodies
+@param stiffnesses: Stiffness of each body's spring
+*/
+static double get_energy(const BodyBatch &bodies, const std::vector<float> &stiffnesses)
+{
+    double energy = 0.0;
+    for (std::size_t i = 0; i < bodies.size(); ++i)
+    {
+        const glm::vec3 position = bodies.get_position(i);
+        const glm::vec3 velocity = bodies.get_linear_velocity(i);
+        energy += 0.5 * glm::dot(velocity, velocity) / bodies.inv_mass[i];
+        energy += 0.5 * stiffnesses[i] * glm::dot(position, position);
+    }
+    return energy;
+}
+
+int main()
+{
+    const SimdLevel level = detect_simd_level();
+    std::printf("%zu bodies, %.0f s simulated, angular motion with %s\n\n", BODY_COUNT, DURATION, get_simd_level_name(level));
+    std::printf("  %-18s %8s %12s %12s %10s\n", "integrator", "step", "final drift", "max drift", "ns/body");
+
+    const std::vector<float> stiffnesses = make_stiffnesses(make_bodies(BODY_COUNT));
+    const auto compute_forces = [&stiffnesses](BodyBatch &bodies)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            float *force = bodies.force[axis].data();
+            const float *position = bodies.position[axis].data();
+            for (std::size_t i = 0; i < bodies.size(); ++i)
+                force[i] -= stiffnesses[i] * position[i];
+        }
+    };
+
+    for (const Integrator integrator : {Integrator::SYMPLECTIC_EULER, Integrator::VELOCITY_VERLET, Integrator::RK4})
+    {
+        for (const float rate : {240.0f, 120.0f, 60.0f, 30.0f})
+        {
+            const float dt = 1.0f / rate;
+            const std::size_t steps = static_cast<std::size_t>(DURATION * rate);
+
+            BodyBatch bodies = make_bodies(BODY_COUNT);
+            const double initial = get_energy(bodies, stiffnesses);
+            double drift = 0.0;
+            double max_drift = 0.0;
+
+            double elapsed = 0.0;
+            for (std::size_t step = 0; step < steps; ++step)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                integrate_bodies(bodies, dt, level, integrator, compute_forces);
+                elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                drift = std::abs(get_energy(bodies, stiffnesses) - initial) / initial;
+                max_drift = std::max(max_drift, drift);
+            }
+
+            std::printf("  %-18s 1/%-6.0f %12.2e %12.2e %10.2f\n", get_integrator_name(integrator), rate, drift, max_drift,
+                        elapsed * 1e9 / static_cast<double>(steps * BODY_COUNT));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include "body_integrator.hpp"
+#include "worker_pool.hpp"
+
+/*
+Benchmark of the body integrator
+Every instruction set supported by the CPU is timed on one thread on the same bodies and compared with the scalar path
+The widest one is then timed on a worker pool, to measure the scaling with the thread count
+*/
+
+// Fill a batch with random bodies, the same seed gives the same bodies
+static BodyBatch make_bodies(const std::size_t count)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> mass(0.5f, 5.0f);
+    const auto vector = [&value, &rng]()
+    {
+        return glm::vec3(value(rng), value(rng), value(rng));
+    };
+
+    BodyBatch bodies;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const glm::vec3 inv_inertia(1.0f / mass(rng), 1.0f / mass(rng), 1.0f / mass(rng));
+        const glm::quat orientation = glm::normalize(glm::quat(value(rng), value(rng), value(rng), value(rng)));
+        bodies.push_back(vector(), vector(), vector(), 1.0f / mass(rng), vector(), vector(), orientation, inv_inertia);
+    }
+    return bodies;
+}
+
+// Largest difference between two batches, relative to the magnitude of the values
+static float get_max_difference(const BodyBatch &a, const BodyBatch &b)
+{
+    float difference = 0.0f;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        const glm::vec3 values[3][2] = {{a.get_position(i), b.get_position(i)},
+                                        {a.get_linear_velocity(i), b.get_linear_velocity(i)},
+                                        {a.get_angular_velocity(i), b.get_angular_velocity(i)}};
+        for (const auto &pair : values)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                difference = std::max(difference, std::abs(pair[0][axis] - pair[1][axis]) / std::max(1.0f, std::abs(pair[1][axis])));
+        }
+
+        const glm::quat orientations[2] = {a.get_orientation(i), b.get_orientation(i)};
+        for (int component = 0; component < 4; ++component)
+            difference = std::max(difference, std::abs(orientations[0][component] - orientations[1][component]));
+    }
+    return difference;
+}
+
+/*
+Integrate for about half a second, returns the number of bodies integrated per second
+@param count: Number of bodies
+@param step: Integrates every body once
+*/
+template <typename Step>
+static double get_bodies_per_second(const std::size_t count, Step &&step)
+{
+    std::size_t steps = 0;
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < 0.5)
+    {
+        step();
+        steps++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return static_cast<double>(count * steps) / elapsed;
+}
+
+int main()
+{
+    constexpr float dt = 1.0f / 60.0f;
+    constexpr std::size_t check_steps = 100;
+    const SimdLevel supported = detect_simd_level();
+    std::printf("Widest supported instruction set: %s\n\n", get_simd_level_name(supported));
+
+    // A batch that fits in the L2 cache, then one that streams from memory
+    for (const std::size_t count : {std::size_t{4096}, std::size_t{1} << 20})
+    {
+        std::printf("%zu bodies\n", count);
+
+        BodyBatch reference = make_bodies(count);
+        for (std::size_t step = 0; step < check_steps; ++step)
+            integrate_bodies(reference, dt, SimdLevel::SCALAR);
+
+        for (int level = 0; level <= static_cast<int>(supported); ++level)
+        {
+            const SimdLevel simd = static_cast<SimdLevel>(level);
+
+            BodyBatch bodies = make_bodies(count);
+            for (std::size_t step = 0; step < check_steps; ++step)
+                integrate_bodies(bodies, dt, simd);
+            const float difference = get_max_difference(bodies, reference);
+
+            // Forces are cleared every step, the kernel cost does not depend on them
+            const double bodies_per_second = get_bodies_per_second(count, [&bodies, simd]()
+                                                                   { integrate_bodies(bodies, dt, simd); });
+            std::printf("  %-8s %8.1f M bodies/s  %6.2f ns/body  max relative difference %.2e\n", get_simd_level_name(simd),
+                        bodies_per_second * 1e-6, 1e9 / bodies_per_second, difference);
+        }
+        std::printf("\n");
+    }
+
+    // Ranges of whole cache lines, about four per thread, as the PhysicsSystem splits them
+    constexpr std::size_t count = std::size_t{1} << 20;
+    const unsigned hardware_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf("%zu bodies, %s, worker pool\n", count, get_simd_level_name(supported));
+
+    // Powers of two, then every hardware thread
+    std::vector<unsigned> thread_counts;
+    for (unsigned threads = 1; threads < hardware_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(hardware_threads);
+
+    BodyBatch bodies = make_bodies(count);
+    double single_thread = 0.0;
+    for (const unsigned threads : thread_counts)
+    {
+        WorkerPool pool(threads);
+        const std::size_t grain = (count / (threads * 4) + BODIES_PER_CACHE_LINE - 1) / BODIES_PER_CACHE_LINE * BODIES_PER_CACHE_LINE;
+        const double bodies_per_second = get_bodies_per_second(count, [&pool, &bodies, grain, supported]()
+                                                               {
+                                                                   pool.parallel_for(count, grain, [&bodies, supported](const std::size_t begin, const std::size_t end)
+                                                                                     { integrate_bodies(bodies, dt, supported, begin, end); });
+                                                               });
+        if (threads == 1)
+            single_thread = bodies_per_second;
+
+        std::printf("  %3u threads %8.1f M bodies/s  speedup %5.2f\n", threads, bodies_per_second * 1e-6, bodies_per_second / single_thread);
+    }
+
+    return 0;
+}
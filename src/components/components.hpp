@@ -1,49 +1,153 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
+#include "component_registry.hpp"
+#include "entity.hpp"
 #include "entity_config.hpp"
 
 
+/*
+Transform relative to the parent, or to the world for entities without a HierarchyComponent
+The orientation is a unit quaternion, Euler angles (degrees) are only converted from and to at the API boundary
+*/
 struct TransformComponent
 {
-    glm::vec3 position, eulers, scale;
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 scale;
 
     TransformComponent(const glm::vec3 &pos = {0.0f, 0.0f, 0.0f},
-                       const glm::vec3 &eulers = {0.0f, 0.0f, 0.0f},
-                       const glm::vec3 &scale = {1.0f, 1.0f, 1.0f}) : position(pos), eulers(eulers), scale(scale)
+                       const glm::quat &orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                       const glm::vec3 &scale = {1.0f, 1.0f, 1.0f}) : position(pos), orientation(orientation), scale(scale)
+    {
+    }
+
+    TransformComponent(const glm::vec3 &pos,
+                       const glm::vec3 &eulers,
+                       const glm::vec3 &scale = {1.0f, 1.0f, 1.0f}) : position(pos), orientation(glm::radians(eulers)), scale(scale)
+    {
+    }
+
+    // Get the orientation as Euler angles, in degrees
+    [[nodiscard]] glm::vec3 get_eulers() const
+    {
+        return glm::degrees(glm::eulerAngles(orientation));
+    }
+
+    /*
+    Set the orientation from Euler angles
+    @param eulers: Pitch, yaw and roll in degrees
+    */
+    void set_eulers(const glm::vec3 &eulers)
+    {
+        orientation = glm::quat(glm::radians(eulers));
+    }
+};
+
+/*
+Attaches an entity to a parent, its TransformComponent is then relative to the parent's world transform
+A dead parent, or one without a transform, makes the entity a root
+*/
+struct HierarchyComponent
+{
+    Entity parent;
+
+    HierarchyComponent(const Entity parent = NULL_ENTITY) : parent(parent)
     {
     }
 };
 
+/*
+Cached model matrix of an entity, written by the TransformSystem and read by the renderer
+Only entities whose transform, or one of whose ancestors' transform, changed are recomputed
+*/
+struct WorldTransformComponent
+{
+    glm::mat4 matrix;
+
+    WorldTransformComponent(const glm::mat4 &matrix = glm::mat4(1.0f)) : matrix(matrix)
+    {
+    }
+};
+
+/*
+Transform at the start of the last physics step, written by the PhysicsSystem before each step
+The TransformSystem blends it with the TransformComponent so motion stays smooth between steps
+Set it along with the TransformComponent to move an entity without blending
+*/
+struct PreviousTransformComponent
+{
+    glm::vec3 position;
+    glm::quat orientation;
+
+    PreviousTransformComponent(const TransformComponent &transform = {}) : position(transform.position), orientation(transform.orientation)
+    {
+    }
+};
+
+/*
+Per-step rigid body state, read and written by the integrator every substep
+Mass, inertia and material live in PhysicsPropertiesComponent, inv_mass is kept in sync with it by the PhysicsSystem
+Bodies that must not move are tagged Static instead
+*/
 struct PhysicsComponent
 {
-    float mass;
     glm::vec3 linear_velocity;
-    glm::vec3 linear_acceleration;
-    glm::vec3 forces;
-    glm::vec3 angular_acceleration;
+    float inv_mass;
     glm::vec3 angular_velocity;
+    glm::vec3 forces;
     glm::vec3 torque;
-    glm::mat3 inv_inertia_tensor;
-    bool is_static;
+    // Time spent below the sleep thresholds, in seconds
+    float rest_time;
+
+    PhysicsComponent(const glm::vec3 &linear_velocity = {0.0f, 0.0f, 0.0f},
+                     const glm::vec3 &angular_velocity = {0.0f, 0.0f, 0.0f}) : linear_velocity(linear_velocity),
+                                                                              inv_mass(1.0f),
+                                                                              angular_velocity(angular_velocity),
+                                                                              forces(0.0f, 0.0f, 0.0f),
+                                                                              torque(0.0f, 0.0f, 0.0f),
+                                                                              rest_time(0.0f)
+    {
+    }
+};
+
+// Surface properties of a rigid body
+struct PhysicsMaterial
+{
+    float restitution = 0.5f;
+    float friction = 0.5f;
+};
 
-    PhysicsComponent(const float mass = 1.0f,
-                     const glm::vec3 &linear_velocity = {0.0f, 0.0f, 0.0f},
-                     const glm::vec3 &angular_velocity = {0.0f, 0.0f, 0.0f},
-                     const bool is_static = false)
+// Selects the force generators applied to a body, one bit per ForceGeneratorId
+using ForceMask = std::uint32_t;
+
+constexpr ForceMask ALL_FORCE_GENERATORS = ~ForceMask(0);
+
+/*
+Read-mostly rigid body data, only touched when mass or shape change
+Setting it again (add_component) marks it changed, the PhysicsSystem then refreshes the inertia and inv_mass
+*/
+struct PhysicsPropertiesComponent
+{
+    float mass;
+    // Diagonal of the inverse inertia tensor, in local space
+    glm::vec3 inv_inertia;
+    PhysicsMaterial material;
+    ForceMask force_mask;
+
+    PhysicsPropertiesComponent(const float mass = 1.0f,
+                               const PhysicsMaterial &material = {},
+                               const ForceMask force_mask = ALL_FORCE_GENERATORS) : mass(mass),
+                                                                                    inv_inertia(1.0f),
+                                                                                    material(material),
+                                                                                    force_mask(force_mask)
     {
-        this->mass = mass;
-        this->linear_velocity = linear_velocity;
-        this->angular_velocity = angular_velocity;
-        this->is_static = is_static;
-
-        // Default values
-        linear_acceleration = {0.0f, 0.0f, 0.0f};
-        forces = {0.0f, 0.0f, 0.0f};
-        angular_acceleration = {0.0f, 0.0f, 0.0f};
-        torque = {0.0f, 0.0f, 0.0f};
-        inv_inertia_tensor = glm::mat3(1.0f);
     }
 };
 
@@ -65,10 +169,82 @@ struct RenderComponent
     }
 };
 
-enum class ComponentType
+// Every component type, a component's id is its position in the list
+using Components = ComponentList<TransformComponent, PhysicsComponent, ColliderComponent, RenderComponent, PhysicsPropertiesComponent,
+                                 HierarchyComponent, WorldTransformComponent, PreviousTransformComponent>;
+
+constexpr std::size_t COMPONENT_TYPE_COUNT = Components::COUNT;
+
+// Size of each component type, indexed by component id
+constexpr std::array<std::size_t, COMPONENT_TYPE_COUNT> COMPONENT_SIZES = Components::SIZES;
+
+/*
+Zero-size markers, they have no storage and only exist as a bit of the entity's signature
+Toggling one never moves component data
+Static: never moved by physics
+Sleeping: at rest, skipped by physics until woken up
+Disabled: ignored by every system
+*/
+struct Static
+{
+};
+
+struct Sleeping
+{
+};
+
+struct Disabled
+{
+};
+
+// Every tag type, tags get the signature bits after the components
+using Tags = ComponentList<Static, Sleeping, Disabled>;
+
+constexpr std::size_t TAG_COUNT = Tags::COUNT;
+
+// Set of component and tag types, one bit per component id then one per tag
+using Signature = BitMask<COMPONENT_TYPE_COUNT + TAG_COUNT>;
+
+// Get the id of a component type, known at compile time
+template <typename T>
+[[nodiscard]] constexpr std::size_t component_id() noexcept
+{
+    static_assert(Components::contains<T>, "Unknown component type");
+    return Components::index_of<T>();
+}
+
+// Get the signature bit of a tag type, known at compile time
+template <typename T>
+[[nodiscard]] constexpr std::size_t tag_id() noexcept
+{
+    static_assert(Tags::contains<T>, "Unknown tag type");
+    return COMPONENT_TYPE_COUNT + Tags::index_of<T>();
+}
+
+// Get the signature bit of a component or tag type
+template <typename T>
+[[nodiscard]] constexpr std::size_t signature_bit() noexcept
+{
+    if constexpr (Tags::contains<T>)
+        return tag_id<T>();
+    else
+        return component_id<T>();
+}
+
+// Get the signature of a set of component and tag types, known at compile time
+template <typename... Ts>
+[[nodiscard]] constexpr Signature component_mask() noexcept
+{
+    Signature mask;
+    (mask.set(signature_bit<Ts>()), ...);
+    return mask;
+}
+
+// Bits of the signature backed by component storage
+constexpr Signature STORED_COMPONENTS_MASK = []
 {
-    TRANSFORM = 1 << 0,
-    PHYSICS = 1 << 1,
-    COLLIDER = 1 << 2,
-    RENDER = 1 << 3,
-};
\ No newline at end of file
+    Signature mask;
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+        mask.set(i);
+    return mask;
+}();
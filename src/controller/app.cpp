@@ -52,15 +52,16 @@ void App::run()
     float dt = 0.0f;
     float previous_time = static_cast<float>(glfwGetTime());
     float current_time = 0.0f;
-    float accumulator_dt = 0.0f;
-    const float physics_dt = 1.0f / 240.0f;
+    float physics_dt = 0.0f;
 
-    // Data for FPS
+    // Data for FPS, substeps and dropped simulation time are summed over the same second
     std::string title_with_fps = std::string(title_) + " | FPS: 0";
     const size_t replace_index = title_with_fps.size() - 1;
     float fps_previous = previous_time;
     float fps_elapsed = 0.0f;
     float frame_count = 0;
+    unsigned substep_count = 0;
+    float dropped_time = 0.0f;
 
     // Main loop
     while (!glfwWindowShouldClose(window_.get()))
@@ -73,31 +74,52 @@ void App::run()
             frame_count++;
         else
         {
-            title_with_fps.replace(replace_index, title_with_fps.size(), std::to_string(frame_count / fps_elapsed));
+            title_with_fps.replace(replace_index, title_with_fps.size(),
+                                   std::to_string(frame_count / fps_elapsed) +
+                                   " | Substeps: " + std::to_string(substep_count / std::max(frame_count, 1.0f)) +
+                                   " | Dropped: " + std::to_string(1000.0f * dropped_time) + " ms");
             glfwSetWindowTitle(window_.get(), title_with_fps.c_str());
             fps_elapsed = 0.0f;
             fps_previous = current_time;
             frame_count = 0;
+            substep_count = 0;
+            dropped_time = 0.0f;
         }
 
         // Compute delta time
         dt = current_time - previous_time;
         previous_time = current_time;
 
-        // Accumulate passed time
-        accumulator_dt += dt;
+        // Accumulate passed time, clamped so a long frame does not stall the next ones
+        time_stepper_.begin_frame(dt);
 
         glfwPollEvents();
 
-        while (accumulator_dt >= physics_dt)
+        while (time_stepper_.next_step(physics_dt))
         {
             physics_system_.update(physics_dt);
-            accumulator_dt -= physics_dt;
+            time_stepper_.end_step(physics_system_.get_max_speed(), physics_system_.get_max_constraint_error());
             process_input(physics_dt);
         }
 
+        const TimeStepStats &step_stats = time_stepper_.get_stats();
+        substep_count += step_stats.substeps;
+        dropped_time += step_stats.dropped_time;
+
+        // Sync point: structural changes recorded by systems are applied here
+        entity_manager_->flush_commands();
+
+        // Nothing iterates here, storage can be reordered by position
+        entity_manager_->reorder_step();
+
+        // Only subtrees whose transform changed get new world matrices, moving bodies are drawn between their last two steps
+        transform_system_.update(time_stepper_.get_alpha());
+
         camera_system_.update();
         render_system_.render();
+
+        // Removals were visible to every system during this frame
+        entity_manager_->clear_removed();
     }
 }
 
@@ -195,7 +217,11 @@ void App::setup_systems()
     if (entity_manager_ == nullptr)
         entity_manager_ = std::make_shared<EntityManager>();
 
+    // Restore spatial locality about every two seconds, a few thousand entities per frame
+    entity_manager_->set_spatial_reordering(120, 4096);
+
     physics_system_ = PhysicsSystem(entity_manager_);
+    transform_system_ = TransformSystem(entity_manager_);
     render_system_ = RenderSystem(shader_, window_, entity_manager_);
     camera_system_ = CameraSystem(shader_, window_);
 }
@@ -204,44 +230,24 @@ void App::setup_systems()
 void App::setup_scene()
 {
     /* ENTITY 1 : CUBE */
-    unsigned entity = entity_manager_->create_entity();
-    TransformComponent transform;
-    RenderComponent render;
-    PhysicsComponent physics;
-    ColliderComponent collider;
-
-    transform.position = {0.0f, 0.0f, 0.0f};
-    transform.eulers = {0.0f, 0.0f, 0.0f};
-    transform.scale = {1.0f, 1.0f, 1.0f};
-    entity_manager_->add_component(entity, transform);
-
-    render.object_type = ObjectType::CUBE;
-    entity_manager_->add_component(entity, render);
-
-    physics.is_static = false;
-    physics.forces = {0.0f, 0.0f, 0.0f};
-    physics.torque = {-5.0f, 3.0f, 10.0f};
-    entity_manager_->add_component(entity, physics);
-
-    entity_manager_->add_component(entity, collider);
+    Prefab cube;
+    cube.set(TransformComponent({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}));
+    cube.set(WorldTransformComponent());
+    cube.set(PreviousTransformComponent(*cube.get<TransformComponent>()));
+    cube.set(RenderComponent(ObjectType::CUBE));
+    cube.set(PhysicsComponent());
+    cube.set(PhysicsPropertiesComponent());
+    cube.get<PhysicsComponent>()->torque = {-5.0f, 3.0f, 10.0f};
+    cube.set(ColliderComponent());
+    entity_manager_->instantiate(cube, 1);
 
     /* ENTITY 2 : SPHERE */
-    entity = entity_manager_->create_entity();
-
-    transform.position = {2.0f, 0.0f, 2.0f};
-    transform.eulers = {0.0f, 0.0f, 0.0f};
-    transform.scale = {0.5f, 0.5f, 0.5f};
-    entity_manager_->add_component(entity, transform);
-
-    render.object_type = ObjectType::SPHERE;
-    entity_manager_->add_component(entity, render);
-
-    physics.is_static = false;
-    physics.forces = {0.0f, 0.0f, 0.0f};
-    physics.torque = {0.0f, 10.0f, 0.0f};
-    entity_manager_->add_component(entity, physics);
-
-    entity_manager_->add_component(entity, collider);
+    Prefab sphere = cube;
+    sphere.set(TransformComponent({2.0f, 0.0f, 2.0f}, {0.0f, 0.0f, 0.0f}, {0.5f, 0.5f, 0.5f}));
+    sphere.set(PreviousTransformComponent(*sphere.get<TransformComponent>()));
+    sphere.set(RenderComponent(ObjectType::SPHERE));
+    sphere.get<PhysicsComponent>()->torque = {0.0f, 10.0f, 0.0f};
+    entity_manager_->instantiate(sphere, 1);
 }
 
 /*
@@ -344,6 +350,12 @@ void App::key_callback(GLFWwindow *window, int key, [[maybe_unused]] int scancod
 
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+
+    // Quick save and quick load, events are polled outside of any system update
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+        app->entity_manager_->save_snapshot("snapshot.ecs");
+    if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+        app->entity_manager_->load_snapshot("snapshot.ecs");
     if (key >= 0 && key < 1024)
     {
         if (action == GLFW_PRESS)
@@ -10,12 +10,15 @@
 #include "physics_system.hpp"
 #include "render_system.hpp"
 #include "camera_system.hpp"
+#include "transform_system.hpp"
 
 #include "shader_factory.hpp"
 #include "mesh_factory.hpp"
 
 #include "entity_manager.hpp"
 
+#include "time_stepper.hpp"
+
 /* 
 App class that will create a resizable window
 @param width: Width of the window
@@ -47,6 +50,8 @@ private:
     RenderSystem render_system_;
     PhysicsSystem physics_system_;
     CameraSystem camera_system_;
+    TransformSystem transform_system_;
+    TimeStepper time_stepper_;
     ShaderFactory shader_factory_;
     std::shared_ptr<EntityManager> entity_manager_ = nullptr;
 
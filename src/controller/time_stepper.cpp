@@ -0,0 +1,144 @@
+#include "time_stepper.hpp"
+
+/*
+Turns frame times into physics steps with an accumulator
+Each frame calls begin_frame, then runs a physics step for every next_step that returns true
+@param settings: Time step settings
+*/
+TimeStepper::TimeStepper(const TimeStepSettings &settings)
+{
+    set_settings(settings);
+}
+
+/*
+Add the time of a frame to the accumulator, clamped to TimeStepSettings::max_frame_time
+A negative or non-finite frame time adds nothing
+@param frame_time: Real time since the previous frame
+*/
+void TimeStepper::begin_frame(const float frame_time)
+{
+    stats_.substeps = 0;
+    stats_.dropped_time = 0.0f;
+
+    if (std::isfinite(frame_time))
+        accumulator_ += std::max(frame_time, 0.0f);
+    if (accumulator_ > settings_.max_frame_time)
+    {
+        drop(accumulator_ - settings_.max_frame_time);
+        accumulator_ = settings_.max_frame_time;
+    }
+}
+
+/*
+Take the next physics step out of the accumulator, returns false when the frame has no step left
+@param step: Set to the step to simulate
+*/
+bool TimeStepper::next_step(float &step)
+{
+    if (accumulator_ < step_)
+        return false;
+
+    // Past the cap the whole steps left are dropped, the remainder stays for the next frame
+    if (stats_.substeps >= settings_.max_substeps)
+    {
+        const float remainder = std::fmod(accumulator_, step_);
+        drop(accumulator_ - remainder);
+        accumulator_ = remainder;
+        return false;
+    }
+
+    step = step_;
+    accumulator_ -= step_;
+    stats_.step = step_;
+    stats_.substeps++;
+    return true;
+}
+
+/*
+Report the motion at the end of a physics step, the adaptive step size is chosen from it
+@param max_speed: Largest linear speed of a body
+@param constraint_error: Largest relative stretch of a spring
+*/
+void TimeStepper::end_step(const float max_speed, const float constraint_error)
+{
+    if (!settings_.adaptive)
+        return;
+
+    float target = settings_.max_step;
+    if (max_speed > 0.0f)
+        target = std::min(target, settings_.max_displacement / max_speed);
+
+    // The stretch of an explicit spring grows with the square of the step
+    if (constraint_error > settings_.constraint_tolerance)
+        target = std::min(target, step_ * std::sqrt(settings_.constraint_tolerance / constraint_error));
+
+    step_ = std::clamp(std::min(target, step_ * MAX_GROWTH), settings_.min_step, settings_.max_step);
+}
+
+/*
+Change the settings, the accumulated time is kept
+@param settings: Time step settings
+*/
+void TimeStepper::set_settings(const TimeStepSettings &settings)
+{
+    settings_ = settings;
+    if (!(settings_.step > 0.0f) || !(settings_.min_step > 0.0f) || !(settings_.max_step > 0.0f))
+    {
+        std::cerr << "[TIME STEPPER WARNING] Physics steps must be positive, the default ones are used\n";
+        settings_.step = TimeStepSettings{}.step;
+        settings_.min_step = TimeStepSettings{}.min_step;
+        settings_.max_step = TimeStepSettings{}.max_step;
+    }
+    if (!(settings_.max_frame_time > 0.0f))
+    {
+        std::cerr << "[TIME STEPPER WARNING] Maximum frame time must be positive, the default one is used\n";
+        settings_.max_frame_time = TimeStepSettings{}.max_frame_time;
+    }
+    settings_.max_substeps = std::max(settings_.max_substeps, 1u);
+    settings_.min_step = std::min(settings_.min_step, settings_.max_step);
+    step_ = settings_.adaptive ? std::clamp(settings_.step, settings_.min_step, settings_.max_step) : settings_.step;
+}
+
+// Get the settings
+[[nodiscard]] const TimeStepSettings &TimeStepper::get_settings() const noexcept
+{
+    return settings_;
+}
+
+// Get what the last frame did
+[[nodiscard]] const TimeStepStats &TimeStepper::get_stats() const noexcept
+{
+    return stats_;
+}
+
+// Get the time accumulated but not simulated yet
+[[nodiscard]] float TimeStepper::get_accumulator() const noexcept
+{
+    return accumulator_;
+}
+
+// Get the step the next physics step will use
+[[nodiscard]] float TimeStepper::get_step() const noexcept
+{
+    return step_;
+}
+
+// Get how far the accumulated time is past the last physics step, in units of that step from 0 to 1, to blend the last two physics states
+[[nodiscard]] float TimeStepper::get_alpha() const noexcept
+{
+    // The last two states are one simulated step apart, end_step may already have resized step_ for the next one
+    const float step = stats_.step > 0.0f ? stats_.step : step_;
+    return std::min(accumulator_ / step, 1.0f);
+}
+
+/*
+Count time as dropped in the stats of the frame
+@param time: Dropped simulation time
+*/
+void TimeStepper::drop(const float time) noexcept
+{
+    if (stats_.dropped_time == 0.0f)
+        stats_.dropped_frames++;
+    stats_.dropped_time += time;
+    stats_.total_dropped_time += time;
+}
\ No newline at end of file
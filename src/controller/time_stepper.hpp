@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/*
+How the fixed physics step is driven by the frame time
+@param step: Physics step, used as is when the step is not adaptive
+@param max_substeps: Most physics steps run in one frame, the time left over is dropped
+@param max_frame_time: Frame time accumulated at most, the rest is dropped so a long frame does not stall the next ones
+@param adaptive: Shrink the step when bodies move fast or springs stretch, and grow it back when they calm down
+@param min_step: Smallest adaptive step
+@param max_step: Largest adaptive step
+@param max_displacement: Distance the fastest body may travel in one adaptive step
+@param constraint_tolerance: Relative spring stretch above which the adaptive step shrinks
+*/
+struct TimeStepSettings
+{
+    float step = 1.0f / 240.0f;
+    unsigned max_substeps = 8;
+    float max_frame_time = 0.1f;
+    bool adaptive = false;
+    float min_step = 1.0f / 960.0f;
+    float max_step = 1.0f / 60.0f;
+    float max_displacement = 0.05f;
+    float constraint_tolerance = 0.1f;
+};
+
+/*
+What the last frame did
+@param substeps: Physics steps run in the frame
+@param step: Step used by the last of them
+@param dropped_time: Simulation time dropped in the frame, by the accumulator clamp or the substep cap
+@param total_dropped_time: Simulation time dropped since the start
+@param dropped_frames: Frames that dropped time since the start
+*/
+struct TimeStepStats
+{
+    unsigned substeps = 0;
+    float step = 0.0f;
+    float dropped_time = 0.0f;
+    float total_dropped_time = 0.0f;
+    unsigned dropped_frames = 0;
+};
+
+/*
+Turns frame times into physics steps with an accumulator
+Each frame calls begin_frame, then runs a physics step for every next_step that returns true
+@param settings: Time step settings
+*/
+class TimeStepper
+{
+public:
+    TimeStepper(const TimeStepSettings &settings = {});
+
+    /*
+    Add the time of a frame to the accumulator, clamped to TimeStepSettings::max_frame_time
+    A negative or non-finite frame time adds nothing
+    @param frame_time: Real time since the previous frame
+    */
+    void begin_frame(const float frame_time);
+
+    /*
+    Take the next physics step out of the accumulator, returns false when the frame has no step left
+    @param step: Set to the step to simulate
+    */
+    bool next_step(float &step);
+
+    /*
+    Report the motion at the end of a physics step, the adaptive step size is chosen from it
+    @param max_speed: Largest linear speed of a body
+    @param constraint_error: Largest relative stretch of a spring
+    */
+    void end_step(const float max_speed, const float constraint_error);
+
+    /*
+    Change the settings, the accumulated time is kept
+    @param settings: Time step settings
+    */
+    void set_settings(const TimeStepSettings &settings);
+
+    // Get the settings
+    [[nodiscard]] const TimeStepSettings &get_settings() const noexcept;
+
+    // Get what the last frame did
+    [[nodiscard]] const TimeStepStats &get_stats() const noexcept;
+
+    // Get the time accumulated but not simulated yet
+    [[nodiscard]] float get_accumulator() const noexcept;
+
+    // Get the step the next physics step will use
+    [[nodiscard]] float get_step() const noexcept;
+
+    // Get how far the accumulated time is past the last physics step, in units of that step from 0 to 1, to blend the last two physics states
+    [[nodiscard]] float get_alpha() const noexcept;
+
+private:
+    // Largest factor the adaptive step grows by in one step, shrinking is immediate
+    static constexpr float MAX_GROWTH = 1.25f;
+
+    TimeStepSettings settings_;
+    TimeStepStats stats_;
+    float accumulator_ = 0.0f;
+    float step_ = 0.0f;
+
+    /*
+    Count time as dropped in the stats of the frame
+    @param time: Dropped simulation time
+    */
+    void drop(const float time) noexcept;
+};
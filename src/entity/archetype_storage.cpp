@@ -0,0 +1,363 @@
+#include "archetype_storage.hpp"
+
+/*
+Archetype based component storage
+@param resource: Memory resource chunks and tables allocate from
+*/
+ArchetypeStorage::ArchetypeStorage(std::pmr::memory_resource *resource) : resource_(resource),
+                                                                         archetypes_(resource),
+                                                                         archetype_indices_(resource),
+                                                                         locations_(resource),
+                                                                         removed_(COMPONENT_TYPE_COUNT, resource)
+{
+}
+
+/*
+Register a new entity, it starts in the empty archetype
+@param entity: Entity's handle
+*/
+void ArchetypeStorage::add_entity(const Entity entity)
+{
+    const unsigned slot = entity_index(entity);
+    if (slot >= locations_.size())
+        locations_.resize(slot + 1);
+
+    const unsigned archetype_index = get_or_create_archetype(Signature{});
+    locations_[slot] = EntityLocation{archetype_index, push_row(archetype_index, entity)};
+}
+
+/*
+Register many new entities directly in the archetype of a mask
+Every row is filled with a copy of the component prototypes
+@param entities: Entities' handles
+@param count: Number of entities
+@param mask: Component mask of the entities
+@param prototypes: Component to copy for each bit of the mask, indexed by component id
+@param tick: Tick stamped as added and changed
+*/
+void ArchetypeStorage::add_entities(const Entity *entities, const std::size_t count, const Signature &mask,
+                                    const std::array<const void *, COMPONENT_TYPE_COUNT> &prototypes, const unsigned tick)
+{
+    unsigned max_slot = 0;
+    for (std::size_t i = 0; i < count; ++i)
+        max_slot = std::max(max_slot, entity_index(entities[i]));
+    if (count > 0 && max_slot >= locations_.size())
+        locations_.resize(max_slot + 1);
+
+    const unsigned archetype_index = get_or_create_archetype(mask);
+    Archetype &archetype = archetypes_[archetype_index];
+
+    // Allocate every chunk needed up front
+    const std::size_t rows = archetype.size + count;
+    const std::size_t chunk_count = (rows + archetype.chunk_capacity - 1) / archetype.chunk_capacity;
+    while (archetype.chunks.size() < chunk_count)
+    {
+        archetype.chunks.push_back(allocate_chunk());
+        archetype.chunk_ticks.push_back(tick);
+    }
+
+    const unsigned first_row = archetype.size;
+    archetype.size = static_cast<unsigned>(rows);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const unsigned row = first_row + static_cast<unsigned>(i);
+        const unsigned chunk = row / archetype.chunk_capacity;
+        const unsigned slot = row % archetype.chunk_capacity;
+
+        archetype.entities(chunk)[slot] = entities[i];
+        locations_[entity_index(entities[i])] = EntityLocation{archetype_index, row};
+
+        for (std::size_t c = 0; c < COMPONENT_TYPE_COUNT; ++c)
+        {
+            if (mask.test(c))
+            {
+                std::memcpy(archetype.column(chunk, c) + COMPONENT_SIZES[c] * slot, prototypes[c], COMPONENT_SIZES[c]);
+                archetype.ticks(chunk, c)[slot] = ComponentTicks{tick, tick};
+            }
+        }
+        archetype.chunk_ticks[chunk] = tick;
+    }
+}
+
+/*
+Remove an entity and all of its components
+@param entity: Entity's handle
+*/
+void ArchetypeStorage::remove_entity(const Entity entity) noexcept
+{
+    const unsigned slot = entity_index(entity);
+    if (slot >= locations_.size() || locations_[slot].archetype == NO_ARCHETYPE)
+        return;
+
+    const Signature &mask = archetypes_[locations_[slot].archetype].mask;
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+    {
+        if (mask.test(i))
+            removed_[i].push_back(entity);
+    }
+
+    swap_remove_row(locations_[slot].archetype, locations_[slot].row);
+    locations_[slot] = EntityLocation{};
+}
+
+/*
+Remove a component from an entity, the entity is moved to the archetype matching its new mask
+Returns false if the entity did not have the component
+@param entity: Entity's handle
+@param component_index: Id of the component type
+*/
+bool ArchetypeStorage::remove(const Entity entity, const std::size_t component_index)
+{
+    const Signature mask = get_mask(entity);
+    if (!mask.test(component_index))
+        return false;
+
+    move_entity(entity, Signature(mask).reset(component_index));
+    removed_[component_index].push_back(entity);
+    return true;
+}
+
+/*
+Get the component mask of an entity
+@param entity: Entity's handle
+*/
+[[nodiscard]] Signature ArchetypeStorage::get_mask(const Entity entity) const noexcept
+{
+    const unsigned slot = entity_index(entity);
+    if (slot >= locations_.size() || locations_[slot].archetype == NO_ARCHETYPE)
+        return Signature{};
+
+    return archetypes_[locations_[slot].archetype].mask;
+}
+
+/*
+Entities whose component was removed since the last call to clear_removed
+@param component_index: Id of the component type
+*/
+[[nodiscard]] const std::pmr::vector<Entity> &ArchetypeStorage::removed(const std::size_t component_index) const noexcept
+{
+    return removed_[component_index];
+}
+
+void ArchetypeStorage::clear_removed() noexcept
+{
+    for (std::pmr::vector<Entity> &removed : removed_)
+        removed.clear();
+}
+
+/*
+Get the archetype and row of an entity
+@param entity: Entity's handle
+*/
+[[nodiscard]] ArchetypeStorage::EntityLocation ArchetypeStorage::get_location(const Entity entity) const noexcept
+{
+    const unsigned slot = entity_index(entity);
+    return slot < locations_.size() ? locations_[slot] : EntityLocation{};
+}
+
+/*
+Swap two rows of an archetype, with their components and ticks
+Handles are unaffected, only the row order changes
+@param archetype_index: Index of the archetype
+@param row_a: First row
+@param row_b: Second row
+*/
+void ArchetypeStorage::swap_rows(const unsigned archetype_index, const unsigned row_a, const unsigned row_b) noexcept
+{
+    if (row_a == row_b)
+        return;
+
+    Archetype &archetype = archetypes_[archetype_index];
+    const unsigned chunk_a = row_a / archetype.chunk_capacity;
+    const unsigned slot_a = row_a % archetype.chunk_capacity;
+    const unsigned chunk_b = row_b / archetype.chunk_capacity;
+    const unsigned slot_b = row_b % archetype.chunk_capacity;
+
+    Entity &entity_a = archetype.entities(chunk_a)[slot_a];
+    Entity &entity_b = archetype.entities(chunk_b)[slot_b];
+    std::swap(entity_a, entity_b);
+    locations_[entity_index(entity_a)].row = row_a;
+    locations_[entity_index(entity_b)].row = row_b;
+
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+    {
+        if (!archetype.mask.test(i))
+            continue;
+
+        std::byte *component_a = archetype.column(chunk_a, i) + COMPONENT_SIZES[i] * slot_a;
+        std::byte *component_b = archetype.column(chunk_b, i) + COMPONENT_SIZES[i] * slot_b;
+        std::swap_ranges(component_a, component_a + COMPONENT_SIZES[i], component_b);
+        std::swap(archetype.ticks(chunk_a, i)[slot_a], archetype.ticks(chunk_b, i)[slot_b]);
+    }
+
+    // Both chunks may now hold the most recent change of either one
+    const unsigned newest = is_newer_tick(archetype.chunk_ticks[chunk_a], archetype.chunk_ticks[chunk_b]) ? archetype.chunk_ticks[chunk_a]
+                                                                                                          : archetype.chunk_ticks[chunk_b];
+    archetype.chunk_ticks[chunk_a] = newest;
+    archetype.chunk_ticks[chunk_b] = newest;
+}
+
+// Get every archetype created so far
+[[nodiscard]] const std::pmr::vector<Archetype> &ArchetypeStorage::get_archetypes() const noexcept
+{
+    return archetypes_;
+}
+
+/*
+Get the index of the archetype of a mask, create it if needed
+@param mask: Component mask
+*/
+[[nodiscard]] unsigned ArchetypeStorage::get_or_create_archetype(const Signature &mask)
+{
+    const auto it = archetype_indices_.find(mask);
+    if (it != archetype_indices_.end())
+        return it->second;
+
+    Archetype archetype(resource_);
+    archetype.mask = mask;
+    archetype.column_offsets.fill(Archetype::NO_COLUMN);
+    archetype.tick_offsets.fill(Archetype::NO_COLUMN);
+
+    // Bytes used by one row, and worst case padding needed to align every column
+    std::size_t row_size = sizeof(Entity);
+    std::size_t padding = 0;
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+    {
+        if (mask.test(i))
+        {
+            row_size += COMPONENT_SIZES[i] + sizeof(ComponentTicks);
+            padding += 2 * ARCHETYPE_COLUMN_ALIGNMENT;
+        }
+    }
+    archetype.chunk_capacity = static_cast<unsigned>((ARCHETYPE_CHUNK_SIZE - padding) / row_size);
+
+    // Columns are laid out one after the other, each starting on a cache line
+    const auto align = [](const std::size_t offset)
+    {
+        return (offset + ARCHETYPE_COLUMN_ALIGNMENT - 1) / ARCHETYPE_COLUMN_ALIGNMENT * ARCHETYPE_COLUMN_ALIGNMENT;
+    };
+
+    std::size_t offset = sizeof(Entity) * archetype.chunk_capacity;
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+    {
+        if (!mask.test(i))
+            continue;
+
+        archetype.column_offsets[i] = align(offset);
+        offset = archetype.column_offsets[i] + COMPONENT_SIZES[i] * archetype.chunk_capacity;
+        archetype.tick_offsets[i] = align(offset);
+        offset = archetype.tick_offsets[i] + sizeof(ComponentTicks) * archetype.chunk_capacity;
+    }
+
+    const unsigned index = static_cast<unsigned>(archetypes_.size());
+    archetypes_.push_back(std::move(archetype));
+    archetype_indices_[mask] = index;
+    return index;
+}
+
+/*
+Move an entity to the archetype of the given mask, shared components are copied
+@param entity: Entity's handle
+@param mask: New component mask
+*/
+void ArchetypeStorage::move_entity(const Entity entity, const Signature &mask)
+{
+    const EntityLocation old_location = locations_[entity_index(entity)];
+    const unsigned new_index = get_or_create_archetype(mask);
+    const unsigned new_row = push_row(new_index, entity);
+
+    // Archetypes may have been reallocated, take references afterwards
+    copy_row(archetypes_[old_location.archetype], old_location.row, archetypes_[new_index], new_row,
+             archetypes_[old_location.archetype].mask & mask);
+
+    swap_remove_row(old_location.archetype, old_location.row);
+    locations_[entity_index(entity)] = EntityLocation{new_index, new_row};
+}
+
+/*
+Append a row for an entity at the end of an archetype and return the row index
+@param archetype_index: Index of the archetype
+@param entity: Entity's handle
+*/
+[[nodiscard]] unsigned ArchetypeStorage::push_row(const unsigned archetype_index, const Entity entity)
+{
+    Archetype &archetype = archetypes_[archetype_index];
+    const unsigned row = archetype.size;
+
+    if (row == archetype.chunks.size() * archetype.chunk_capacity)
+    {
+        archetype.chunks.push_back(allocate_chunk());
+        archetype.chunk_ticks.push_back(0);
+    }
+
+    archetype.entities(row / archetype.chunk_capacity)[row % archetype.chunk_capacity] = entity;
+    archetype.size++;
+    return row;
+}
+
+/*
+Remove a row by moving the last row of the archetype into it
+@param archetype_index: Index of the archetype
+@param row: Row to remove
+*/
+void ArchetypeStorage::swap_remove_row(const unsigned archetype_index, const unsigned row) noexcept
+{
+    Archetype &archetype = archetypes_[archetype_index];
+    const unsigned last = archetype.size - 1;
+
+    if (row != last)
+    {
+        const Entity moved_entity = archetype.entities(last / archetype.chunk_capacity)[last % archetype.chunk_capacity];
+        archetype.entities(row / archetype.chunk_capacity)[row % archetype.chunk_capacity] = moved_entity;
+        copy_row(archetype, last, archetype, row, archetype.mask);
+        locations_[entity_index(moved_entity)].row = row;
+    }
+
+    archetype.size--;
+
+    // Release the last chunk once it is empty
+    if (archetype.size == (archetype.chunks.size() - 1) * archetype.chunk_capacity)
+    {
+        archetype.chunks.pop_back();
+        archetype.chunk_ticks.pop_back();
+    }
+}
+
+/*
+Copy a row's components and ticks to another row
+@param from: Source archetype
+@param from_row: Source row
+@param to: Destination archetype
+@param to_row: Destination row
+@param mask: Components to copy
+*/
+void ArchetypeStorage::copy_row(const Archetype &from, const unsigned from_row, Archetype &to, const unsigned to_row, const Signature &mask) noexcept
+{
+    const unsigned from_chunk = from_row / from.chunk_capacity;
+    const unsigned from_slot = from_row % from.chunk_capacity;
+    const unsigned to_chunk = to_row / to.chunk_capacity;
+    const unsigned to_slot = to_row % to.chunk_capacity;
+
+    for (std::size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i)
+    {
+        if (mask.test(i))
+        {
+            std::memcpy(to.column(to_chunk, i) + COMPONENT_SIZES[i] * to_slot,
+                        from.column(from_chunk, i) + COMPONENT_SIZES[i] * from_slot,
+                        COMPONENT_SIZES[i]);
+            to.ticks(to_chunk, i)[to_slot] = from.ticks(from_chunk, i)[from_slot];
+        }
+    }
+
+    // Keep the chunk's tick an upper bound of the ticks it holds
+    if (is_newer_tick(from.chunk_ticks[from_chunk], to.chunk_ticks[to_chunk]))
+        to.chunk_ticks[to_chunk] = from.chunk_ticks[from_chunk];
+}
+
+// Allocate an uninitialized chunk from the memory resource
+[[nodiscard]] ArchetypeChunkPtr ArchetypeStorage::allocate_chunk()
+{
+    void *memory = resource_->allocate(sizeof(ArchetypeChunk), alignof(ArchetypeChunk));
+    return ArchetypeChunkPtr(new (memory) ArchetypeChunk, ArchetypeChunkDeleter{resource_});
+}
\ No newline at end of file
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "change_tracking.hpp"
+#include "components.hpp"
+#include "entity.hpp"
+
+// Size in bytes of one chunk of an archetype
+constexpr std::size_t ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+// Alignment of chunks and of each column inside a chunk
+constexpr std::size_t ARCHETYPE_COLUMN_ALIGNMENT = 64;
+
+/*
+Fixed-size block of memory holding rows of an archetype
+Each component is stored in its own column (SoA), the first column holds the entities ids
+Each component column is followed by a column of ComponentTicks
+*/
+struct alignas(ARCHETYPE_COLUMN_ALIGNMENT) ArchetypeChunk
+{
+    std::byte data[ARCHETYPE_CHUNK_SIZE];
+};
+
+// Gives a chunk back to the memory resource it was allocated from
+struct ArchetypeChunkDeleter
+{
+    std::pmr::memory_resource *resource = nullptr;
+
+    void operator()(ArchetypeChunk *chunk) const noexcept
+    {
+        chunk->~ArchetypeChunk();
+        resource->deallocate(chunk, sizeof(ArchetypeChunk), alignof(ArchetypeChunk));
+    }
+};
+
+using ArchetypeChunkPtr = std::unique_ptr<ArchetypeChunk, ArchetypeChunkDeleter>;
+
+/*
+Every entity sharing the same component mask
+Rows are packed: every chunk is full except the last one
+@param resource: Memory resource the chunk tables allocate from
+*/
+struct Archetype
+{
+    static constexpr std::size_t NO_COLUMN = ~std::size_t{0};
+
+    explicit Archetype(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : chunks(resource), chunk_ticks(resource)
+    {
+    }
+
+    Signature mask;
+    unsigned chunk_capacity = 0;
+    unsigned size = 0;
+    std::array<std::size_t, COMPONENT_TYPE_COUNT> column_offsets{};
+    std::array<std::size_t, COMPONENT_TYPE_COUNT> tick_offsets{};
+    std::pmr::vector<ArchetypeChunkPtr> chunks;
+
+    // Most recent change tick of any row of each chunk, lets change queries skip whole chunks
+    std::pmr::vector<unsigned> chunk_ticks;
+
+    // Entities column of a chunk
+    [[nodiscard]] Entity *entities(const std::size_t chunk) const noexcept
+    {
+        return reinterpret_cast<Entity *>(chunks[chunk]->data);
+    }
+
+    /*
+    Column of a component in a chunk
+    @param chunk: Chunk index
+    @param component_index: Id of the component type
+    */
+    [[nodiscard]] std::byte *column(const std::size_t chunk, const std::size_t component_index) const noexcept
+    {
+        return chunks[chunk]->data + column_offsets[component_index];
+    }
+
+    /*
+    Ticks column of a component in a chunk
+    @param chunk: Chunk index
+    @param component_index: Id of the component type
+    */
+    [[nodiscard]] ComponentTicks *ticks(const std::size_t chunk, const std::size_t component_index) const noexcept
+    {
+        return reinterpret_cast<ComponentTicks *>(chunks[chunk]->data + tick_offsets[component_index]);
+    }
+
+    // Number of rows used in a chunk
+    [[nodiscard]] unsigned chunk_size(const std::size_t chunk) const noexcept
+    {
+        return chunk + 1 < chunks.size() ? chunk_capacity : size - static_cast<unsigned>(chunk) * chunk_capacity;
+    }
+};
+
+/*
+Archetype based component storage
+Entities with the same component mask live together in fixed-size SoA chunks
+Queries only walk the chunks of matching archetypes, no per-entity mask test is needed
+Components must be trivially copyable, rows are moved with memcpy
+@param resource: Memory resource chunks and tables allocate from
+*/
+class ArchetypeStorage
+{
+public:
+    static constexpr unsigned NO_ARCHETYPE = ~0u;
+
+    explicit ArchetypeStorage(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // Where the row of an entity lives
+    struct EntityLocation
+    {
+        unsigned archetype = NO_ARCHETYPE;
+        unsigned row = 0;
+    };
+
+    /*
+    Register a new entity, it starts in the empty archetype
+    @param entity: Entity's handle
+    */
+    void add_entity(const Entity entity);
+
+    /*
+    Register many new entities directly in the archetype of a mask
+    Every row is filled with a copy of the component prototypes
+    @param entities: Entities' handles
+    @param count: Number of entities
+    @param mask: Component mask of the entities
+    @param prototypes: Component to copy for each bit of the mask, indexed by component id
+    @param tick: Tick stamped as added and changed
+    */
+    void add_entities(const Entity *entities, const std::size_t count, const Signature &mask,
+                      const std::array<const void *, COMPONENT_TYPE_COUNT> &prototypes, const unsigned tick = 0);
+
+    /*
+    Remove an entity and all of its components
+    @param entity: Entity's handle
+    */
+    void remove_entity(const Entity entity) noexcept;
+
+    /*
+    Add a component to an entity, or overwrite the existing one
+    The entity is moved to the archetype matching its new mask if needed
+    @param entity: Entity's handle
+    @param component: Component to store
+    @param tick: Tick stamped as added (new component) and changed
+    */
+    template <typename T>
+    void set(const Entity entity, const T &component, const unsigned tick = 0)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Archetype components must be trivially copyable");
+
+        constexpr std::size_t id = component_id<T>();
+        const bool is_new = !get_mask(entity).test(id);
+        if (is_new)
+            move_entity(entity, Signature(get_mask(entity)).set(id));
+
+        const EntityLocation &location = locations_[entity_index(entity)];
+        Archetype &archetype = archetypes_[location.archetype];
+        const unsigned chunk = location.row / archetype.chunk_capacity;
+        const unsigned slot = location.row % archetype.chunk_capacity;
+        new (archetype.column(chunk, id) + sizeof(T) * slot) T(component);
+
+        ComponentTicks &ticks = archetype.ticks(chunk, id)[slot];
+        if (is_new)
+            ticks.added = tick;
+        ticks.changed = tick;
+        archetype.chunk_ticks[chunk] = tick;
+    }
+
+    /*
+    Stamp the component of an entity as changed, the entity must have it
+    @param entity: Entity's handle
+    @param tick: Tick of the change
+    */
+    template <typename T>
+    void mark_changed(const Entity entity, const unsigned tick) noexcept
+    {
+        const EntityLocation &location = locations_[entity_index(entity)];
+        Archetype &archetype = archetypes_[location.archetype];
+        const unsigned chunk = location.row / archetype.chunk_capacity;
+        archetype.ticks(chunk, component_id<T>())[location.row % archetype.chunk_capacity].changed = tick;
+        archetype.chunk_ticks[chunk] = tick;
+    }
+
+    /*
+    Get the ticks of the component of an entity, or nullptr if it has none
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    [[nodiscard]] const ComponentTicks *find_ticks(const Entity entity) const noexcept
+    {
+        if (!get_mask(entity).test(component_id<T>()))
+            return nullptr;
+
+        const EntityLocation &location = locations_[entity_index(entity)];
+        const Archetype &archetype = archetypes_[location.archetype];
+        return archetype.ticks(location.row / archetype.chunk_capacity, component_id<T>()) + location.row % archetype.chunk_capacity;
+    }
+
+    /*
+    Remove a component from an entity, the entity is moved to the archetype matching its new mask
+    Returns false if the entity did not have the component
+    @param entity: Entity's handle
+    @param component_index: Id of the component type
+    */
+    bool remove(const Entity entity, const std::size_t component_index);
+
+    /*
+    Get the component of an entity, or nullptr if it has none
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    [[nodiscard]] T *find(const Entity entity) noexcept
+    {
+        if (!get_mask(entity).test(component_id<T>()))
+            return nullptr;
+
+        const EntityLocation &location = locations_[entity_index(entity)];
+        const Archetype &archetype = archetypes_[location.archetype];
+        std::byte *column = archetype.column(location.row / archetype.chunk_capacity, component_id<T>());
+        return std::launder(reinterpret_cast<T *>(column)) + location.row % archetype.chunk_capacity;
+    }
+
+    /*
+    Call a function on each entity that has all the given components, chunk by chunk
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename... Ts, typename Func>
+    void each(Func &&func)
+    {
+        constexpr Signature required = component_mask<std::remove_const_t<Ts>...>();
+
+        for (const Archetype &archetype : archetypes_)
+        {
+            if (!archetype.mask.contains(required))
+                continue;
+
+            for (std::size_t chunk = 0; chunk < archetype.chunks.size(); ++chunk)
+            {
+                const unsigned count = archetype.chunk_size(chunk);
+                const Entity *entities = archetype.entities(chunk);
+                auto columns = std::make_tuple(std::launder(reinterpret_cast<Ts *>(
+                    archetype.column(chunk, component_id<std::remove_const_t<Ts>>())))...);
+
+                for (unsigned row = 0; row < count; ++row)
+                    func(entities[row], std::get<Ts *>(columns)[row]...);
+            }
+        }
+    }
+
+    /*
+    Call a function on each entity that has all the given components and whose tracked component was added or changed since a tick
+    Chunks without any recent change are skipped entirely
+    @param tracked_index: Id of the tracked component type
+    @param since: Reference tick
+    @param added_only: Only visit components added since the tick
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename... Ts, typename Func>
+    void each_since(const std::size_t tracked_index, const unsigned since, const bool added_only, Func &&func)
+    {
+        const Signature required = Signature(component_mask<std::remove_const_t<Ts>...>()).set(tracked_index);
+
+        for (const Archetype &archetype : archetypes_)
+        {
+            if (!archetype.mask.contains(required))
+                continue;
+
+            for (std::size_t chunk = 0; chunk < archetype.chunks.size(); ++chunk)
+            {
+                if (!is_newer_tick(archetype.chunk_ticks[chunk], since))
+                    continue;
+
+                const unsigned count = archetype.chunk_size(chunk);
+                const Entity *entities = archetype.entities(chunk);
+                const ComponentTicks *ticks = archetype.ticks(chunk, tracked_index);
+                auto columns = std::make_tuple(std::launder(reinterpret_cast<Ts *>(
+                    archetype.column(chunk, component_id<std::remove_const_t<Ts>>())))...);
+
+                for (unsigned row = 0; row < count; ++row)
+                {
+                    if (is_newer_tick(added_only ? ticks[row].added : ticks[row].changed, since))
+                        func(entities[row], std::get<Ts *>(columns)[row]...);
+                }
+            }
+        }
+    }
+
+    // Number of entities that have all the given components
+    template <typename... Ts>
+    [[nodiscard]] std::size_t count() const noexcept
+    {
+        constexpr Signature required = component_mask<Ts...>();
+
+        std::size_t total = 0;
+        for (const Archetype &archetype : archetypes_)
+        {
+            if (archetype.mask.contains(required))
+                total += archetype.size;
+        }
+        return total;
+    }
+
+    /*
+    Get the component mask of an entity
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] Signature get_mask(const Entity entity) const noexcept;
+
+    /*
+    Entities whose component was removed since the last call to clear_removed
+    @param component_index: Id of the component type
+    */
+    [[nodiscard]] const std::pmr::vector<Entity> &removed(const std::size_t component_index) const noexcept;
+
+    void clear_removed() noexcept;
+
+    /*
+    Get the archetype and row of an entity
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] EntityLocation get_location(const Entity entity) const noexcept;
+
+    /*
+    Swap two rows of an archetype, with their components and ticks
+    Handles are unaffected, only the row order changes
+    @param archetype_index: Index of the archetype
+    @param row_a: First row
+    @param row_b: Second row
+    */
+    void swap_rows(const unsigned archetype_index, const unsigned row_a, const unsigned row_b) noexcept;
+
+    // Get every archetype created so far
+    [[nodiscard]] const std::pmr::vector<Archetype> &get_archetypes() const noexcept;
+
+private:
+    std::pmr::memory_resource *resource_ = nullptr;
+    std::pmr::vector<Archetype> archetypes_;
+    std::pmr::unordered_map<Signature, unsigned, Signature::Hasher> archetype_indices_;
+    std::pmr::vector<EntityLocation> locations_;
+
+    // One list per component id
+    std::pmr::vector<std::pmr::vector<Entity>> removed_;
+
+    // Allocate an uninitialized chunk from the memory resource
+    [[nodiscard]] ArchetypeChunkPtr allocate_chunk();
+
+    /*
+    Get the index of the archetype of a mask, create it if needed
+    @param mask: Component mask
+    */
+    [[nodiscard]] unsigned get_or_create_archetype(const Signature &mask);
+
+    /*
+    Move an entity to the archetype of the given mask, shared components are copied
+    @param entity: Entity's handle
+    @param mask: New component mask
+    */
+    void move_entity(const Entity entity, const Signature &mask);
+
+    /*
+    Copy a row's components and ticks to another row
+    @param from: Source archetype
+    @param from_row: Source row
+    @param to: Destination archetype
+    @param to_row: Destination row
+    @param mask: Components to copy
+    */
+    static void copy_row(const Archetype &from, const unsigned from_row, Archetype &to, const unsigned to_row, const Signature &mask) noexcept;
+
+    /*
+    Append a row for an entity at the end of an archetype and return the row index
+    @param archetype_index: Index of the archetype
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] unsigned push_row(const unsigned archetype_index, const Entity entity);
+
+    /*
+    Remove a row by moving the last row of the archetype into it
+    @param archetype_index: Index of the archetype
+    @param row: Row to remove
+    */
+    void swap_remove_row(const unsigned archetype_index, const unsigned row) noexcept;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+Ticks at which a component was added and last changed
+Every mutation is stamped with the EntityManager's current tick
+*/
+struct ComponentTicks
+{
+    unsigned added = 0;
+    unsigned changed = 0;
+};
+
+/*
+Check if a tick is more recent than another one, robust to wrap-around
+@param tick: Tick to test
+@param since: Reference tick
+*/
+[[nodiscard]] constexpr bool is_newer_tick(const unsigned tick, const unsigned since) noexcept
+{
+    return static_cast<int>(tick - since) > 0;
+}
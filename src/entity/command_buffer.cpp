@@ -0,0 +1,50 @@
+#include "command_buffer.hpp"
+
+/*
+Record the creation of an entity
+@param prefab: Components given to the entity
+*/
+void CommandBuffer::create_entity(const Prefab &prefab)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    creates_.push_back(prefab);
+}
+
+/*
+Record the destruction of an entity
+@param entity: Entity's handle
+*/
+void CommandBuffer::destroy_entity(const Entity entity)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    destroys_.push_back(entity);
+}
+
+// Check if no command was recorded
+[[nodiscard]] bool CommandBuffer::empty()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    bool no_adds = true;
+    std::apply([&no_adds](const auto &...adds)
+               { no_adds = (adds.empty() && ...); },
+               adds_);
+    bool no_removes = true;
+    std::apply([&no_removes](const auto &...removes)
+               { no_removes = (removes.empty() && ...); },
+               removes_);
+    return creates_.empty() && destroys_.empty() && no_adds && no_removes;
+}
+
+// Drop every recorded command
+void CommandBuffer::clear()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    creates_.clear();
+    destroys_.clear();
+    std::apply([](auto &...adds)
+               { (adds.clear(), ...); },
+               adds_);
+    std::apply([](auto &...removes)
+               { (removes.clear(), ...); },
+               removes_);
+}
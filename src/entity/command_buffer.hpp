@@ -0,0 +1,82 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "components.hpp"
+#include "entity.hpp"
+#include "prefab.hpp"
+
+/*
+Records structural changes (creates, destroys, component adds and removes) to apply them later
+Recording is thread-safe, so systems and worker jobs can record while others iterate
+The EntityManager applies every command in one batched flush, in this order:
+creates, component adds, component removes, destroys
+*/
+class CommandBuffer
+{
+public:
+    CommandBuffer() = default;
+    CommandBuffer(const CommandBuffer &) = delete;
+    CommandBuffer &operator=(const CommandBuffer &) = delete;
+
+    /*
+    Record the creation of an entity
+    @param prefab: Components given to the entity
+    */
+    void create_entity(const Prefab &prefab);
+
+    /*
+    Record the destruction of an entity
+    @param entity: Entity's handle
+    */
+    void destroy_entity(const Entity entity);
+
+    /*
+    Record adding a component to an entity, the last recorded value wins
+    @param entity: Entity's handle
+    @param component: Component to add
+    */
+    template <typename T>
+    void add_component(const Entity entity, const T &component)
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        std::get<component_id<T>()>(adds_).emplace_back(entity, component);
+    }
+
+    /*
+    Record removing a component from an entity
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    void remove_component(const Entity entity)
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        std::get<component_id<T>()>(removes_).push_back(entity);
+    }
+
+    // Check if no command was recorded
+    [[nodiscard]] bool empty();
+
+    // Drop every recorded command
+    void clear();
+
+private:
+    friend class EntityManager;
+
+    // Recorded adds of one component type
+    template <typename T>
+    using AddList = std::vector<std::pair<Entity, T>>;
+
+    // Recorded removes of one component type
+    template <typename T>
+    using RemoveList = std::vector<Entity>;
+
+    std::mutex mutex_;
+    std::vector<Prefab> creates_;
+    std::vector<Entity> destroys_;
+    Components::Map<AddList> adds_;
+    Components::Map<RemoveList> removes_;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+/*
+Fixed-size bit set usable in constant expressions, used as an entity's component signature
+@param BITS: Number of bits, not limited to 32 or 64
+*/
+template <std::size_t BITS>
+class BitMask
+{
+public:
+    static constexpr std::size_t WORD_COUNT = BITS == 0 ? 1 : (BITS + 63) / 64;
+
+    constexpr BitMask() noexcept = default;
+
+    /*
+    Set a bit
+    @param bit: Bit position
+    */
+    constexpr BitMask &set(const std::size_t bit) noexcept
+    {
+        words_[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        return *this;
+    }
+
+    /*
+    Clear a bit
+    @param bit: Bit position
+    */
+    constexpr BitMask &reset(const std::size_t bit) noexcept
+    {
+        words_[bit / 64] &= ~(std::uint64_t{1} << (bit % 64));
+        return *this;
+    }
+
+    /*
+    Check if a bit is set
+    @param bit: Bit position
+    */
+    [[nodiscard]] constexpr bool test(const std::size_t bit) const noexcept
+    {
+        return (words_[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    /*
+    Check if every bit of another mask is set in this one
+    @param other: Mask to test
+    */
+    [[nodiscard]] constexpr bool contains(const BitMask &other) const noexcept
+    {
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            if ((words_[i] & other.words_[i]) != other.words_[i])
+                return false;
+        }
+        return true;
+    }
+
+    /*
+    Check if at least one bit is set in both masks
+    @param other: Mask to test
+    */
+    [[nodiscard]] constexpr bool intersects(const BitMask &other) const noexcept
+    {
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            if (words_[i] & other.words_[i])
+                return true;
+        }
+        return false;
+    }
+
+    // Check if no bit is set
+    [[nodiscard]] constexpr bool none() const noexcept
+    {
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            if (words_[i] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] constexpr BitMask operator|(const BitMask &other) const noexcept
+    {
+        BitMask result;
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+            result.words_[i] = words_[i] | other.words_[i];
+        return result;
+    }
+
+    [[nodiscard]] constexpr BitMask operator&(const BitMask &other) const noexcept
+    {
+        BitMask result;
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+            result.words_[i] = words_[i] & other.words_[i];
+        return result;
+    }
+
+    [[nodiscard]] constexpr BitMask operator~() const noexcept
+    {
+        BitMask result;
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+            result.words_[i] = ~words_[i];
+        return result;
+    }
+
+    constexpr BitMask &operator|=(const BitMask &other) noexcept { return *this = *this | other; }
+    constexpr BitMask &operator&=(const BitMask &other) noexcept { return *this = *this & other; }
+
+    [[nodiscard]] constexpr bool operator==(const BitMask &other) const noexcept
+    {
+        for (std::size_t i = 0; i < WORD_COUNT; ++i)
+        {
+            if (words_[i] != other.words_[i])
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] constexpr bool operator!=(const BitMask &other) const noexcept { return !(*this == other); }
+
+    // Hash of the mask, to key maps by signature
+    [[nodiscard]] std::size_t hash() const noexcept
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const std::uint64_t word : words_)
+            hash = (hash ^ word) * 1099511628211ull;
+        return static_cast<std::size_t>(hash);
+    }
+
+    struct Hasher
+    {
+        [[nodiscard]] std::size_t operator()(const BitMask &mask) const noexcept { return mask.hash(); }
+    };
+
+private:
+    std::array<std::uint64_t, WORD_COUNT> words_{};
+};
+
+// Empty value standing for a type, to pass types to generic lambdas
+template <typename T>
+struct TypeTag
+{
+    using type = T;
+};
+
+/*
+Compile-time list of component types
+Each type gets its position in the list as id, so ids and signatures fold into constants
+@param Cs: Component types
+*/
+template <typename... Cs>
+struct ComponentList
+{
+    static constexpr std::size_t COUNT = sizeof...(Cs);
+
+    // Size of each component type, indexed by id
+    static constexpr std::array<std::size_t, COUNT> SIZES{sizeof(Cs)...};
+
+    // Check if a type is part of the list
+    template <typename T>
+    static constexpr bool contains = (std::is_same_v<T, Cs> || ...);
+
+    // Get the id of a component type, COUNT if it is not in the list
+    template <typename T>
+    [[nodiscard]] static constexpr std::size_t index_of() noexcept
+    {
+        constexpr std::array<bool, COUNT> matches{std::is_same_v<T, Cs>...};
+        for (std::size_t i = 0; i < COUNT; ++i)
+        {
+            if (matches[i])
+                return i;
+        }
+        return COUNT;
+    }
+
+    /*
+    Call a function once per component type, in id order
+    @param func: Callable as func(TypeTag<C>)
+    */
+    template <typename Func>
+    static constexpr void for_each(Func &&func)
+    {
+        (func(TypeTag<Cs>{}), ...);
+    }
+
+    // Tuple holding one Wrapper<C> per component type
+    template <template <typename> class Wrapper>
+    using Map = std::tuple<Wrapper<Cs>...>;
+};
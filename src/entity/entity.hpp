@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+Generational entity handle
+Low bits hold the index of the entity's slot, high bits hold the generation of that slot
+The generation is bumped each time the slot is recycled, so stale handles never alias new entities
+*/
+using Entity = std::uint32_t;
+
+constexpr unsigned ENTITY_INDEX_BITS = 22;
+// A slot whose generation saturates is retired instead of wrapping, so a slot serves 1024 entities
+// A workload that keeps recycling entities leaks a slot (its entry and mask) each time one is used 1024 times,
+// and runs out of slots after about 2^32 entities created in total
+constexpr unsigned ENTITY_GENERATION_BITS = 32 - ENTITY_INDEX_BITS;
+constexpr Entity ENTITY_INDEX_MASK = (Entity{1} << ENTITY_INDEX_BITS) - 1;
+constexpr Entity ENTITY_GENERATION_MASK = (Entity{1} << ENTITY_GENERATION_BITS) - 1;
+
+// Handle that never refers to an entity, its index is never allocated
+constexpr Entity NULL_ENTITY = ~Entity{0};
+
+// Maximum number of entities alive at the same time
+constexpr unsigned MAX_ENTITIES = ENTITY_INDEX_MASK;
+
+/*
+Get the slot index of an entity
+@param entity: Entity's handle
+*/
+[[nodiscard]] constexpr unsigned entity_index(const Entity entity) noexcept
+{
+    return entity & ENTITY_INDEX_MASK;
+}
+
+/*
+Get the generation of an entity
+@param entity: Entity's handle
+*/
+[[nodiscard]] constexpr unsigned entity_generation(const Entity entity) noexcept
+{
+    return (entity >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK;
+}
+
+/*
+Build an entity handle
+@param index: Slot index
+@param generation: Generation of the slot
+*/
+[[nodiscard]] constexpr Entity make_entity(const unsigned index, const unsigned generation) noexcept
+{
+    return (static_cast<Entity>(generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+}
@@ -0,0 +1,160 @@
+#include "memory_resources.hpp"
+
+/*
+Memory resource forwarding to another one while counting allocations
+@param upstream: Resource serving the allocations
+*/
+CountingResource::CountingResource(std::pmr::memory_resource *upstream) noexcept : upstream_(upstream)
+{
+}
+
+/*
+Change the resource serving the allocations, only before anything was allocated
+@param upstream: Resource serving the allocations
+*/
+void CountingResource::set_upstream(std::pmr::memory_resource *upstream) noexcept
+{
+    upstream_ = upstream;
+}
+
+// Get the allocation counters
+[[nodiscard]] const AllocationStats &CountingResource::get_stats() const noexcept
+{
+    return stats_;
+}
+
+void *CountingResource::do_allocate(const std::size_t bytes, const std::size_t alignment)
+{
+    void *pointer = upstream_->allocate(bytes, alignment);
+    stats_.allocations++;
+    stats_.bytes_in_use += bytes;
+    if (stats_.bytes_in_use > stats_.peak_bytes)
+        stats_.peak_bytes = stats_.bytes_in_use;
+    return pointer;
+}
+
+void CountingResource::do_deallocate(void *pointer, const std::size_t bytes, const std::size_t alignment)
+{
+    upstream_->deallocate(pointer, bytes, alignment);
+    stats_.deallocations++;
+    stats_.bytes_in_use -= bytes;
+}
+
+[[nodiscard]] bool CountingResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+/*
+Pool memory resource reserving whole pages from its upstream resource
+@param upstream: Resource the pages are taken from
+*/
+PagePoolResource::PagePoolResource(std::pmr::memory_resource *upstream) noexcept : upstream_(upstream)
+{
+}
+
+PagePoolResource::~PagePoolResource()
+{
+    release();
+}
+
+// Return every page to the upstream resource, every pooled block becomes invalid, large blocks stay owned by their users
+void PagePoolResource::release() noexcept
+{
+    for (const Page &page : pages_)
+    {
+        upstream_->deallocate(page.data, page.size, page.alignment);
+        reserved_bytes_ -= page.size;
+    }
+
+    pages_.clear();
+    free_lists_.fill(nullptr);
+}
+
+// Number of bytes currently taken from the upstream resource
+[[nodiscard]] std::size_t PagePoolResource::get_reserved_bytes() const noexcept
+{
+    return reserved_bytes_;
+}
+
+/*
+Get the size class of a block, SIZE_CLASS_COUNT if it is too large to be pooled
+@param bytes: Size of the block
+@param alignment: Alignment of the block
+*/
+[[nodiscard]] std::size_t PagePoolResource::get_size_class(const std::size_t bytes, const std::size_t alignment) noexcept
+{
+    // Blocks are aligned on their own size, so a large enough class satisfies any alignment
+    const std::size_t needed = bytes > alignment ? bytes : alignment;
+
+    std::size_t size_class = 0;
+    while (size_class < SIZE_CLASS_COUNT && (MIN_BLOCK_SIZE << size_class) < needed)
+        size_class++;
+    return size_class;
+}
+
+/*
+Round a size up to a whole number of pages
+@param bytes: Size to round
+*/
+[[nodiscard]] std::size_t PagePoolResource::round_to_pages(const std::size_t bytes) noexcept
+{
+    return (bytes + MEMORY_PAGE_SIZE - 1) / MEMORY_PAGE_SIZE * MEMORY_PAGE_SIZE;
+}
+
+void *PagePoolResource::do_allocate(const std::size_t bytes, const std::size_t alignment)
+{
+    const std::size_t size_class = get_size_class(bytes, alignment);
+
+    // Large blocks, like the dense arrays of big scenes, get pages of their own
+    if (size_class == SIZE_CLASS_COUNT)
+    {
+        const std::size_t size = round_to_pages(bytes);
+        void *pointer = upstream_->allocate(size, alignment);
+        reserved_bytes_ += size;
+        return pointer;
+    }
+
+    if (free_lists_[size_class] == nullptr)
+    {
+        // Reserve a whole page and split it into blocks of this class
+        const std::size_t block_size = MIN_BLOCK_SIZE << size_class;
+        const std::size_t page_size = block_size > MEMORY_PAGE_SIZE ? block_size : MEMORY_PAGE_SIZE;
+        std::byte *data = static_cast<std::byte *>(upstream_->allocate(page_size, block_size));
+        pages_.push_back(Page{data, page_size, block_size});
+        reserved_bytes_ += page_size;
+
+        for (std::size_t offset = page_size; offset >= block_size; offset -= block_size)
+        {
+            FreeBlock *block = reinterpret_cast<FreeBlock *>(data + offset - block_size);
+            block->next = free_lists_[size_class];
+            free_lists_[size_class] = block;
+        }
+    }
+
+    FreeBlock *block = free_lists_[size_class];
+    free_lists_[size_class] = block->next;
+    return block;
+}
+
+void PagePoolResource::do_deallocate(void *pointer, const std::size_t bytes, const std::size_t alignment)
+{
+    const std::size_t size_class = get_size_class(bytes, alignment);
+
+    if (size_class == SIZE_CLASS_COUNT)
+    {
+        const std::size_t size = round_to_pages(bytes);
+        upstream_->deallocate(pointer, size, alignment);
+        reserved_bytes_ -= size;
+        return;
+    }
+
+    FreeBlock *block = static_cast<FreeBlock *>(pointer);
+    block->next = free_lists_[size_class];
+    free_lists_[size_class] = block;
+}
+
+[[nodiscard]] bool PagePoolResource::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Granularity at which the page pool reserves memory
+constexpr std::size_t MEMORY_PAGE_SIZE = 4 * 1024;
+
+// Largest block served from the page pool's free lists, bigger blocks get their own pages
+constexpr std::size_t MEMORY_MAX_POOLED_SIZE = 64 * 1024;
+
+/*
+Allocation counters of a memory resource
+@param allocations: Number of allocations
+@param deallocations: Number of deallocations
+@param bytes_in_use: Bytes currently allocated
+@param peak_bytes: Highest value reached by bytes_in_use
+*/
+struct AllocationStats
+{
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+    std::size_t bytes_in_use = 0;
+    std::size_t peak_bytes = 0;
+};
+
+/*
+Memory resource forwarding to another one while counting allocations
+Comparing the counters before and after a frame shows if it allocated
+@param upstream: Resource serving the allocations
+*/
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::get_default_resource()) noexcept;
+
+    /*
+    Change the resource serving the allocations, only before anything was allocated
+    @param upstream: Resource serving the allocations
+    */
+    void set_upstream(std::pmr::memory_resource *upstream) noexcept;
+
+    // Get the allocation counters
+    [[nodiscard]] const AllocationStats &get_stats() const noexcept;
+
+private:
+    std::pmr::memory_resource *upstream_ = nullptr;
+    AllocationStats stats_;
+
+    void *do_allocate(const std::size_t bytes, const std::size_t alignment) override;
+    void do_deallocate(void *pointer, const std::size_t bytes, const std::size_t alignment) override;
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+/*
+Pool memory resource reserving whole pages from its upstream resource
+Small blocks are rounded to a power of two and carved from pages kept on per-size free lists,
+freed blocks are reused and pages are only returned on release or destruction
+Blocks above MEMORY_MAX_POOLED_SIZE are rounded to whole pages and returned as soon as they are freed
+Not thread-safe
+@param upstream: Resource the pages are taken from
+*/
+class PagePoolResource : public std::pmr::memory_resource
+{
+public:
+    explicit PagePoolResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource()) noexcept;
+    PagePoolResource(const PagePoolResource &) = delete;
+    PagePoolResource &operator=(const PagePoolResource &) = delete;
+    ~PagePoolResource() override;
+
+    // Return every page to the upstream resource, every pooled block becomes invalid, large blocks stay owned by their users
+    void release() noexcept;
+
+    // Number of bytes currently taken from the upstream resource
+    [[nodiscard]] std::size_t get_reserved_bytes() const noexcept;
+
+private:
+    static constexpr std::size_t MIN_BLOCK_SIZE = 16;
+    static constexpr std::size_t SIZE_CLASS_COUNT = 13;
+
+    static_assert(MIN_BLOCK_SIZE << (SIZE_CLASS_COUNT - 1) == MEMORY_MAX_POOLED_SIZE, "Size classes must reach the largest pooled size");
+
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct Page
+    {
+        void *data;
+        std::size_t size;
+        std::size_t alignment;
+    };
+
+    std::pmr::memory_resource *upstream_ = nullptr;
+    std::array<FreeBlock *, SIZE_CLASS_COUNT> free_lists_{};
+    std::vector<Page> pages_;
+    std::size_t reserved_bytes_ = 0;
+
+    /*
+    Get the size class of a block, SIZE_CLASS_COUNT if it is too large to be pooled
+    @param bytes: Size of the block
+    @param alignment: Alignment of the block
+    */
+    [[nodiscard]] static std::size_t get_size_class(const std::size_t bytes, const std::size_t alignment) noexcept;
+
+    /*
+    Round a size up to a whole number of pages
+    @param bytes: Size to round
+    */
+    [[nodiscard]] static std::size_t round_to_pages(const std::size_t bytes) noexcept;
+
+    void *do_allocate(const std::size_t bytes, const std::size_t alignment) override;
+    void do_deallocate(void *pointer, const std::size_t bytes, const std::size_t alignment) override;
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
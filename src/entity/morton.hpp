@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Number of bits per axis in a 3D Morton code
+constexpr unsigned MORTON_AXIS_BITS = 21;
+
+/*
+Spread the 21 low bits of a value so that two zero bits separate each of them
+@param value: Value to spread
+*/
+[[nodiscard]] constexpr std::uint64_t morton_spread_bits(std::uint64_t value) noexcept
+{
+    value &= 0x1fffff;
+    value = (value | value << 32) & 0x1f00000000ffff;
+    value = (value | value << 16) & 0x1f0000ff0000ff;
+    value = (value | value << 8) & 0x100f00f00f00f00f;
+    value = (value | value << 4) & 0x10c30c30c30c30c3;
+    value = (value | value << 2) & 0x1249249249249249;
+    return value;
+}
+
+/*
+Morton (Z-order) code of a position, positions close in space get close codes
+@param position: Position to encode
+@param min: Lower corner of the encoded volume
+@param scale: Number of quantization steps per unit on each axis
+*/
+[[nodiscard]] inline std::uint64_t morton_code(const glm::vec3 &position, const glm::vec3 &min, const glm::vec3 &scale) noexcept
+{
+    constexpr float max_step = static_cast<float>((1u << MORTON_AXIS_BITS) - 1);
+    const auto quantize = [max_step](const float value, const float origin, const float steps)
+    {
+        // A NaN fails every comparison and clamp keeps it, casting it is undefined, so it maps to 0
+        const float step = (value - origin) * steps;
+        return static_cast<std::uint64_t>(!(step >= 0.0f) ? 0.0f : std::min(step, max_step));
+    };
+
+    return morton_spread_bits(quantize(position.x, min.x, scale.x)) |
+           morton_spread_bits(quantize(position.y, min.y, scale.y)) << 1 |
+           morton_spread_bits(quantize(position.z, min.z, scale.z)) << 2;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+#include "components.hpp"
+#include "entity.hpp"
+
+/*
+Template set of components and tags used to spawn many identical entities at once
+Components left empty are not added to the instances
+*/
+struct Prefab
+{
+    Components::Map<std::optional> components;
+    Signature tags;
+
+    /*
+    Give a component or a tag to the prefab, replacing the previous component
+    @param component: Component copied to every instance, or tag
+    */
+    template <typename T>
+    Prefab &set([[maybe_unused]] const T &component)
+    {
+        if constexpr (Tags::contains<T>)
+            tags.set(tag_id<T>());
+        else
+            std::get<component_id<T>()>(components).emplace(component);
+        return *this;
+    }
+
+    // Get a component of the prefab, empty if it has none
+    template <typename T>
+    [[nodiscard]] std::optional<T> &get() noexcept
+    {
+        return std::get<component_id<T>()>(components);
+    }
+
+    // Get a component of the prefab, empty if it has none
+    template <typename T>
+    [[nodiscard]] const std::optional<T> &get() const noexcept
+    {
+        return std::get<component_id<T>()>(components);
+    }
+
+    // Get the signature of the components and tags the prefab has
+    [[nodiscard]] Signature get_mask() const noexcept
+    {
+        Signature mask = tags;
+        Components::for_each([this, &mask](auto tag)
+                             {
+                                 using T = typename decltype(tag)::type;
+                                 if (get<T>())
+                                     mask.set(component_id<T>());
+                             });
+        return mask;
+    }
+};
+
+/*
+Components of one entity created from a prefab, given to the per-instance initializer
+Pointers are nullptr for components the prefab does not have
+*/
+struct PrefabInstance
+{
+    Entity entity = NULL_ENTITY;
+    Components::Map<std::add_pointer_t> components{};
+
+    // Get a component of the instance, or nullptr if the prefab does not have it
+    template <typename T>
+    [[nodiscard]] T *get() const noexcept
+    {
+        return std::get<component_id<T>()>(components);
+    }
+};
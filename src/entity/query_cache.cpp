@@ -0,0 +1,155 @@
+#include "query_cache.hpp"
+
+/*
+Persistent lists of the entities matching registered query signatures
+@param resource: Memory resource the lists allocate from
+*/
+QueryCache::QueryCache(std::pmr::memory_resource *resource) : resource_(resource), queries_(resource)
+{
+}
+
+/*
+Get the index of a query, register it and collect its entities if needed
+@param include: Components the entities must have
+@param exclude: Components and tags the entities must not have
+@param masks: Entities masks, indexed by entity index
+@param slots: Entities handles, indexed by entity index
+*/
+[[nodiscard]] unsigned QueryCache::get_or_register(const Signature &include, const Signature &exclude,
+                                                   const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots)
+{
+    // Systems register a handful of queries, a linear search beats hashing two signatures
+    for (std::size_t i = 0; i < queries_.size(); ++i)
+    {
+        if (queries_[i].include == include && queries_[i].exclude == exclude)
+            return static_cast<unsigned>(i);
+    }
+
+    Query &query = queries_.emplace_back(resource_);
+    query.include = include;
+    query.exclude = exclude;
+    collect(query, masks, slots);
+
+    return static_cast<unsigned>(queries_.size() - 1);
+}
+
+/*
+Collect the entities of every query again, after the masks were replaced at once
+@param masks: Entities masks, indexed by entity index
+@param slots: Entities handles, indexed by entity index
+*/
+void QueryCache::rebuild(const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots)
+{
+    for (Query &query : queries_)
+    {
+        query.entities.clear();
+        collect(query, masks, slots);
+    }
+}
+
+/*
+Update every query after an entity's mask changed
+@param entity: Entity's handle
+@param old_mask: Mask before the change
+@param new_mask: Mask after the change
+*/
+void QueryCache::on_mask_changed(const Entity entity, const Signature &old_mask, const Signature &new_mask)
+{
+    for (Query &query : queries_)
+    {
+        const bool matched = query.matches(old_mask);
+        const bool matches = query.matches(new_mask);
+
+        if (!matched && matches)
+            insert(query, entity);
+        else if (matched && !matches)
+            erase(query, entity);
+    }
+}
+
+/*
+Entities matching a query, in no particular order
+@param query: Index returned by get_or_register
+*/
+[[nodiscard]] const std::pmr::vector<Entity> &QueryCache::entities(const unsigned query) const noexcept
+{
+    return queries_[query].entities;
+}
+
+/*
+Sort every list by a rank, then rebuild the positions
+@param ranks: Rank of each entity, indexed by entity index, missing entities go last
+*/
+void QueryCache::sort(const std::pmr::vector<unsigned> &ranks)
+{
+    const auto rank = [&ranks](const Entity entity)
+    {
+        const unsigned slot = entity_index(entity);
+        return slot < ranks.size() ? ranks[slot] : INVALID_INDEX;
+    };
+
+    for (Query &query : queries_)
+    {
+        std::sort(query.entities.begin(), query.entities.end(), [&rank](const Entity a, const Entity b)
+                  { return rank(a) < rank(b); });
+
+        for (std::size_t i = 0; i < query.entities.size(); ++i)
+            query.positions[entity_index(query.entities[i])] = static_cast<unsigned>(i);
+    }
+}
+
+// Number of registered queries
+[[nodiscard]] std::size_t QueryCache::size() const noexcept
+{
+    return queries_.size();
+}
+
+/*
+Collect every entity matching a query
+@param query: Query to fill, its list must be empty
+@param masks: Entities masks, indexed by entity index
+@param slots: Entities handles, indexed by entity index
+*/
+void QueryCache::collect(Query &query, const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots)
+{
+    query.positions.assign(masks.size(), INVALID_INDEX);
+
+    // Free slots have an empty mask, a query always includes at least one component
+    for (std::size_t slot = 0; slot < masks.size(); ++slot)
+    {
+        if (query.matches(masks[slot]))
+            insert(query, slots[slot]);
+    }
+}
+
+/*
+Append an entity to a query's list
+@param query: Query to update
+@param entity: Entity's handle
+*/
+void QueryCache::insert(Query &query, const Entity entity)
+{
+    const unsigned slot = entity_index(entity);
+    if (slot >= query.positions.size())
+        query.positions.resize(slot + 1, INVALID_INDEX);
+
+    query.positions[slot] = static_cast<unsigned>(query.entities.size());
+    query.entities.push_back(entity);
+}
+
+/*
+Remove an entity from a query's list, the last entity is moved into its place
+@param query: Query to update
+@param entity: Entity's handle
+*/
+void QueryCache::erase(Query &query, const Entity entity) noexcept
+{
+    const unsigned slot = entity_index(entity);
+    const unsigned position = query.positions[slot];
+    const Entity last = query.entities.back();
+
+    query.entities[position] = last;
+    query.positions[entity_index(last)] = position;
+    query.entities.pop_back();
+    query.positions[slot] = INVALID_INDEX;
+}
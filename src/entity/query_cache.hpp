@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory_resource>
+#include <vector>
+
+#include "components.hpp"
+#include "entity.hpp"
+
+// Components and tags a query skips, passed to EntityManager::query
+template <typename... Ts>
+struct Exclude
+{
+};
+
+/*
+Persistent lists of the entities matching registered query signatures
+Lists are updated incrementally when an entity's mask changes, so iterating a query never tests masks
+A query matches an entity that has every included bit and none of the excluded ones
+@param resource: Memory resource the lists allocate from
+*/
+class QueryCache
+{
+public:
+    static constexpr unsigned INVALID_INDEX = ~0u;
+
+    explicit QueryCache(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /*
+    Get the index of a query, register it and collect its entities if needed
+    @param include: Components the entities must have
+    @param exclude: Components and tags the entities must not have
+    @param masks: Entities masks, indexed by entity index
+    @param slots: Entities handles, indexed by entity index
+    */
+    [[nodiscard]] unsigned get_or_register(const Signature &include, const Signature &exclude,
+                                           const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots);
+
+    /*
+    Collect the entities of every query again, after the masks were replaced at once
+    @param masks: Entities masks, indexed by entity index
+    @param slots: Entities handles, indexed by entity index
+    */
+    void rebuild(const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots);
+
+    /*
+    Update every query after an entity's mask changed
+    @param entity: Entity's handle
+    @param old_mask: Mask before the change
+    @param new_mask: Mask after the change
+    */
+    void on_mask_changed(const Entity entity, const Signature &old_mask, const Signature &new_mask);
+
+    /*
+    Entities matching a query, in no particular order
+    @param query: Index returned by get_or_register
+    */
+    [[nodiscard]] const std::pmr::vector<Entity> &entities(const unsigned query) const noexcept;
+
+    /*
+    Sort every list by a rank, then rebuild the positions
+    @param ranks: Rank of each entity, indexed by entity index, missing entities go last
+    */
+    void sort(const std::pmr::vector<unsigned> &ranks);
+
+    // Number of registered queries
+    [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+    struct Query
+    {
+        explicit Query(std::pmr::memory_resource *resource) : entities(resource), positions(resource)
+        {
+        }
+
+        Signature include;
+        Signature exclude;
+        std::pmr::vector<Entity> entities;
+
+        // Position of each entity in the list, indexed by entity index
+        std::pmr::vector<unsigned> positions;
+
+        [[nodiscard]] bool matches(const Signature &mask) const noexcept
+        {
+            return mask.contains(include) && !mask.intersects(exclude);
+        }
+    };
+
+    std::pmr::memory_resource *resource_ = nullptr;
+
+    // A deque keeps the lists in place when a query is registered during iteration
+    std::pmr::deque<Query> queries_;
+
+    /*
+    Collect every entity matching a query
+    @param query: Query to fill, its list must be empty
+    @param masks: Entities masks, indexed by entity index
+    @param slots: Entities handles, indexed by entity index
+    */
+    static void collect(Query &query, const std::pmr::vector<Signature> &masks, const std::pmr::vector<Entity> &slots);
+
+    /*
+    Append an entity to a query's list
+    @param query: Query to update
+    @param entity: Entity's handle
+    */
+    static void insert(Query &query, const Entity entity);
+
+    /*
+    Remove an entity from a query's list, the last entity is moved into its place
+    @param query: Query to update
+    @param entity: Entity's handle
+    */
+    static void erase(Query &query, const Entity entity) noexcept;
+};
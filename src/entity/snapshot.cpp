@@ -0,0 +1,237 @@
+#include "snapshot.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Write a snapshot file, arrays are written as-is
+@param path: Path of the file, overwritten
+*/
+SnapshotWriter::SnapshotWriter(const std::string &path) : file_(path, std::ios::binary | std::ios::trunc)
+{
+}
+
+// Check if the file could be created
+[[nodiscard]] bool SnapshotWriter::is_open() const noexcept
+{
+    return file_.is_open();
+}
+
+/*
+Write the header, must be written first
+@param header: Header to write
+*/
+void SnapshotWriter::write_header(const SnapshotHeader &header)
+{
+    write_padded(&header, sizeof(header));
+}
+
+// Flush the file, returns false if any write failed
+[[nodiscard]] bool SnapshotWriter::finish()
+{
+    file_.flush();
+    return file_.good();
+}
+
+/*
+Write an array of raw bytes
+@param data: First element
+@param count: Number of elements
+@param element_size: Size of an element in bytes
+*/
+void SnapshotWriter::write_section(const void *data, const std::size_t count, const std::size_t element_size)
+{
+    // The section is aligned past its fields, built in a zeroed buffer so no stack bytes reach the file
+    const SnapshotSection section{count, element_size};
+    char bytes[sizeof(SnapshotSection)];
+    std::memset(bytes, 0, sizeof(bytes));
+    std::memcpy(bytes + offsetof(SnapshotSection, count), &section.count, sizeof(section.count));
+    std::memcpy(bytes + offsetof(SnapshotSection, element_size), &section.element_size, sizeof(section.element_size));
+    file_.write(bytes, sizeof(bytes));
+    write_padded(data, count * element_size);
+}
+
+/*
+Write raw bytes, then pad to SNAPSHOT_ALIGNMENT
+@param data: Bytes to write
+@param size: Number of bytes
+*/
+void SnapshotWriter::write_padded(const void *data, const std::size_t size)
+{
+    static constexpr char padding[SNAPSHOT_ALIGNMENT] = {};
+
+    if (size > 0)
+        file_.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+    if (size % SNAPSHOT_ALIGNMENT != 0)
+        file_.write(padding, static_cast<std::streamsize>(SNAPSHOT_ALIGNMENT - size % SNAPSHOT_ALIGNMENT));
+}
+
+/*
+Read-only memory mapping of a whole file, unmapped on destruction
+@param path: Path of the file
+*/
+MappedFile::MappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    file_handle_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        return;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+        return;
+    mapping_handle_ = mapping;
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+        return;
+
+    data_ = static_cast<const std::byte *>(view);
+    size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+        return;
+
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+    {
+        void *view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (view != MAP_FAILED)
+        {
+            // Arrays are copied front to back once
+            madvise(view, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+            data_ = static_cast<const std::byte *>(view);
+            size_ = static_cast<std::size_t>(info.st_size);
+        }
+    }
+
+    // The mapping keeps its own reference to the file
+    close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_handle_ != nullptr)
+        CloseHandle(mapping_handle_);
+    if (file_handle_ != nullptr)
+        CloseHandle(file_handle_);
+#else
+    if (data_ != nullptr)
+        munmap(const_cast<std::byte *>(data_), size_);
+#endif
+}
+
+// First byte of the file, nullptr if it could not be mapped
+[[nodiscard]] const std::byte *MappedFile::data() const noexcept
+{
+    return data_;
+}
+
+// Size of the file in bytes
+[[nodiscard]] std::size_t MappedFile::size() const noexcept
+{
+    return size_;
+}
+
+/*
+Read a snapshot file through a memory mapping, arrays are returned in place without copy
+@param path: Path of the file
+*/
+SnapshotReader::SnapshotReader(const std::string &path) : file_(path)
+{
+}
+
+// Get the header, nullptr if the file is missing, truncated or of another version or build
+[[nodiscard]] const SnapshotHeader *SnapshotReader::read_header()
+{
+    if (file_.data() == nullptr)
+    {
+        error_ = "file could not be opened";
+        return nullptr;
+    }
+    if (file_.size() < sizeof(SnapshotHeader))
+    {
+        error_ = "file is truncated";
+        return nullptr;
+    }
+
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(file_.data());
+    if (header->magic != SNAPSHOT_MAGIC)
+        error_ = "not a snapshot file";
+    else if (header->byte_order != SNAPSHOT_BYTE_ORDER)
+        error_ = "snapshot was written on a machine of another endianness";
+    else if (header->version != SNAPSHOT_VERSION)
+        error_ = "unsupported snapshot version";
+    else if (header->layout_hash != SNAPSHOT_LAYOUT_HASH)
+        error_ = "snapshot was written with other component layouts";
+    else
+    {
+        offset_ = (sizeof(SnapshotHeader) + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        return header;
+    }
+    return nullptr;
+}
+
+// Describe why the last read failed
+[[nodiscard]] const char *SnapshotReader::get_error() const noexcept
+{
+    return error_;
+}
+
+/*
+Get the next array of raw bytes, nullptr if it is truncated or of another element size
+@param count: Set to the number of elements
+@param element_size: Expected size of an element in bytes
+*/
+[[nodiscard]] const void *SnapshotReader::read_section(std::size_t &count, const std::size_t element_size)
+{
+    count = 0;
+    if (file_.size() < sizeof(SnapshotSection) || offset_ > file_.size() - sizeof(SnapshotSection))
+    {
+        error_ = "file is truncated";
+        return nullptr;
+    }
+
+    const SnapshotSection *section = reinterpret_cast<const SnapshotSection *>(file_.data() + offset_);
+    if (section->element_size != element_size)
+    {
+        error_ = "unexpected array type";
+        return nullptr;
+    }
+
+    const std::size_t begin = offset_ + sizeof(SnapshotSection);
+    const std::size_t available = file_.size() - begin;
+    if (section->count > available / element_size)
+    {
+        error_ = "file is truncated";
+        return nullptr;
+    }
+
+    const std::size_t bytes = static_cast<std::size_t>(section->count) * element_size;
+    offset_ = begin + (bytes + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+    count = static_cast<std::size_t>(section->count);
+    return file_.data() + begin;
+}
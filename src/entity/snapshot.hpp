@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+#include "components.hpp"
+#include "entity.hpp"
+
+// First bytes of every snapshot file
+constexpr std::array<char, 8> SNAPSHOT_MAGIC = {'E', 'C', 'S', 'S', 'N', 'A', 'P', '\0'};
+
+// Bumped whenever the file layout or a component's layout changes
+constexpr std::uint32_t SNAPSHOT_VERSION = 6;
+
+// Written as-is, reads differently on a machine of the other endianness
+constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// Sections start on this boundary so mapped arrays are aligned for any component
+constexpr std::size_t SNAPSHOT_ALIGNMENT = 64;
+
+// Hash of the size and alignment of every stored type, guards against loading a snapshot of another build
+constexpr std::uint64_t SNAPSHOT_LAYOUT_HASH = []
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&hash](const std::uint64_t value)
+    {
+        hash ^= value;
+        hash *= 1099511628211ull;
+    };
+
+    mix(sizeof(Entity));
+    mix(sizeof(Signature));
+    mix(COMPONENT_TYPE_COUNT);
+    Components::for_each([&mix](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             mix(sizeof(T));
+                             mix(alignof(T));
+                         });
+    return hash;
+}();
+
+/*
+Start of a snapshot file, followed by SnapshotSections in this order:
+entity slots, entity masks, free slots, then the dense entities and dense components of each component type
+@param slot_count: Number of entity slots, free ones included
+@param free_slot_count: Number of free slots
+@param entity_count: Number of living entities
+*/
+struct SnapshotHeader
+{
+    std::array<char, 8> magic = SNAPSHOT_MAGIC;
+    std::uint32_t version = SNAPSHOT_VERSION;
+    std::uint32_t byte_order = SNAPSHOT_BYTE_ORDER;
+    std::uint64_t layout_hash = SNAPSHOT_LAYOUT_HASH;
+    std::uint32_t slot_count = 0;
+    std::uint32_t free_slot_count = 0;
+    std::uint32_t entity_count = 0;
+    std::uint32_t reserved = 0;
+};
+
+/*
+Header of an array in a snapshot, the elements follow it, padded to SNAPSHOT_ALIGNMENT
+@param count: Number of elements
+@param element_size: Size of an element in bytes
+*/
+struct alignas(SNAPSHOT_ALIGNMENT) SnapshotSection
+{
+    std::uint64_t count = 0;
+    std::uint64_t element_size = 0;
+};
+
+/*
+Write a snapshot file, arrays are written as-is
+@param path: Path of the file, overwritten
+*/
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(const std::string &path);
+
+    // Check if the file could be created
+    [[nodiscard]] bool is_open() const noexcept;
+
+    /*
+    Write the header, must be written first
+    @param header: Header to write
+    */
+    void write_header(const SnapshotHeader &header);
+
+    /*
+    Write an array
+    @param data: First element
+    @param count: Number of elements
+    */
+    template <typename T>
+    void write_section(const T *data, const std::size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Snapshot arrays must be trivially copyable");
+        write_section(data, count, sizeof(T));
+    }
+
+    // Flush the file, returns false if any write failed
+    [[nodiscard]] bool finish();
+
+private:
+    std::ofstream file_;
+
+    /*
+    Write an array of raw bytes
+    @param data: First element
+    @param count: Number of elements
+    @param element_size: Size of an element in bytes
+    */
+    void write_section(const void *data, const std::size_t count, const std::size_t element_size);
+
+    /*
+    Write raw bytes, then pad to SNAPSHOT_ALIGNMENT
+    @param data: Bytes to write
+    @param size: Number of bytes
+    */
+    void write_padded(const void *data, const std::size_t size);
+};
+
+/*
+Read-only memory mapping of a whole file, unmapped on destruction
+@param path: Path of the file
+*/
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    // First byte of the file, nullptr if it could not be mapped
+    [[nodiscard]] const std::byte *data() const noexcept;
+
+    // Size of the file in bytes
+    [[nodiscard]] std::size_t size() const noexcept;
+
+private:
+    const std::byte *data_ = nullptr;
+    std::size_t size_ = 0;
+
+    // Windows only, file and mapping handles
+    void *file_handle_ = nullptr;
+    void *mapping_handle_ = nullptr;
+};
+
+/*
+Read a snapshot file through a memory mapping, arrays are returned in place without copy
+Returned pointers stay valid as long as the reader
+@param path: Path of the file
+*/
+class SnapshotReader
+{
+public:
+    explicit SnapshotReader(const std::string &path);
+
+    // Get the header, nullptr if the file is missing, truncated or of another version or build
+    [[nodiscard]] const SnapshotHeader *read_header();
+
+    /*
+    Get the next array, nullptr if it is truncated or of another type
+    @param count: Set to the number of elements
+    */
+    template <typename T>
+    [[nodiscard]] const T *read_section(std::size_t &count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "Snapshot arrays must be trivially copyable");
+        return static_cast<const T *>(read_section(count, sizeof(T)));
+    }
+
+    // Describe why the last read failed
+    [[nodiscard]] const char *get_error() const noexcept;
+
+private:
+    MappedFile file_;
+    std::size_t offset_ = 0;
+    const char *error_ = "";
+
+    /*
+    Get the next array of raw bytes, nullptr if it is truncated or of another element size
+    @param count: Set to the number of elements
+    @param element_size: Expected size of an element in bytes
+    */
+    [[nodiscard]] const void *read_section(std::size_t &count, const std::size_t element_size);
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+#include "change_tracking.hpp"
+#include "entity.hpp"
+
+/*
+Sparse set storage for one component type
+Components are packed in a dense array, a sparse table maps an entity's index to its dense index
+Add and remove are O(1) (swap-and-pop), iteration walks contiguous memory
+Each dense slot also stores the ticks at which its component was added and last changed
+@param resource: Memory resource every array allocates from
+*/
+template <typename T>
+class SparseSet
+{
+public:
+    static constexpr unsigned INVALID_INDEX = ~0u;
+
+    explicit SparseSet(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : sparse_(resource),
+                                                                                                  dense_entities_(resource),
+                                                                                                  dense_components_(resource),
+                                                                                                  dense_ticks_(resource),
+                                                                                                  removed_(resource)
+    {
+    }
+
+    /*
+    Add a component to an entity, or overwrite the existing one
+    @param entity: Entity's handle
+    @param component: Component to store
+    @param tick: Tick stamped as added (new component) and changed
+    */
+    T &emplace(const Entity entity, const T &component, const unsigned tick = 0)
+    {
+        const unsigned slot = entity_index(entity);
+        if (slot >= sparse_.size())
+            sparse_.resize(slot + 1, INVALID_INDEX);
+
+        const unsigned index = sparse_[slot];
+        if (index != INVALID_INDEX)
+        {
+            dense_entities_[index] = entity;
+            dense_components_[index] = component;
+            dense_ticks_[index].changed = tick;
+            return dense_components_[index];
+        }
+
+        sparse_[slot] = static_cast<unsigned>(dense_entities_.size());
+        dense_entities_.push_back(entity);
+        dense_components_.push_back(component);
+        dense_ticks_.push_back(ComponentTicks{tick, tick});
+        return dense_components_.back();
+    }
+
+    /*
+    Add the same component to many entities at once, none of them may already be in the set
+    Storage grows once and the component is copied in bulk
+    @param entities: Entities' handles
+    @param count: Number of entities
+    @param component: Component to copy
+    @param tick: Tick stamped as added and changed
+    */
+    void insert(const Entity *entities, const std::size_t count, const T &component, const unsigned tick = 0)
+    {
+        unsigned max_slot = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            max_slot = std::max(max_slot, entity_index(entities[i]));
+        if (count > 0 && max_slot >= sparse_.size())
+            sparse_.resize(max_slot + 1, INVALID_INDEX);
+
+        const unsigned first = static_cast<unsigned>(dense_entities_.size());
+        dense_entities_.insert(dense_entities_.end(), entities, entities + count);
+        dense_components_.resize(first + count, component);
+        dense_ticks_.resize(first + count, ComponentTicks{tick, tick});
+
+        for (std::size_t i = 0; i < count; ++i)
+            sparse_[entity_index(entities[i])] = first + static_cast<unsigned>(i);
+    }
+
+    /*
+    Replace every component with copies of contiguous arrays, the sparse table is rebuilt
+    The replaced entities are remembered as removed until clear_removed is called
+    @param entities: Entities' handles, in dense order
+    @param components: Components, in dense order
+    @param count: Number of entities
+    @param tick: Tick stamped as added and changed
+    */
+    void assign(const Entity *entities, const T *components, const std::size_t count, const unsigned tick = 0)
+    {
+        removed_.insert(removed_.end(), dense_entities_.begin(), dense_entities_.end());
+        dense_entities_.assign(entities, entities + count);
+        dense_components_.assign(components, components + count);
+        dense_ticks_.assign(count, ComponentTicks{tick, tick});
+
+        unsigned max_slot = 0;
+        for (std::size_t i = 0; i < count; ++i)
+            max_slot = std::max(max_slot, entity_index(entities[i]));
+        sparse_.assign(count > 0 ? max_slot + 1 : 0, INVALID_INDEX);
+
+        for (std::size_t i = 0; i < count; ++i)
+            sparse_[entity_index(entities[i])] = static_cast<unsigned>(i);
+    }
+
+    /*
+    Remove the component of an entity, the last component is moved into the freed slot
+    The entity is remembered until clear_removed is called
+    Returns false if the entity had no component
+    @param entity: Entity's handle
+    */
+    bool remove(const Entity entity) noexcept
+    {
+        if (!contains(entity))
+            return false;
+
+        const unsigned index = sparse_[entity_index(entity)];
+        const unsigned last = static_cast<unsigned>(dense_entities_.size()) - 1;
+
+        if (index != last)
+        {
+            dense_entities_[index] = dense_entities_[last];
+            dense_components_[index] = std::move(dense_components_[last]);
+            dense_ticks_[index] = dense_ticks_[last];
+            sparse_[entity_index(dense_entities_[index])] = index;
+        }
+
+        dense_entities_.pop_back();
+        dense_components_.pop_back();
+        dense_ticks_.pop_back();
+        sparse_[entity_index(entity)] = INVALID_INDEX;
+        removed_.push_back(entity);
+        return true;
+    }
+
+    /*
+    Move the component of an entity to a dense index, the component stored there takes its old place
+    Handles are unaffected, only the dense order changes, the entity must be in the set
+    @param entity: Entity's handle
+    @param index: Dense index, lower than size()
+    */
+    void move_to(const Entity entity, const unsigned index) noexcept
+    {
+        const unsigned from = sparse_[entity_index(entity)];
+        if (from == index)
+            return;
+
+        const Entity other = dense_entities_[index];
+        std::swap(dense_entities_[from], dense_entities_[index]);
+        std::swap(dense_components_[from], dense_components_[index]);
+        std::swap(dense_ticks_[from], dense_ticks_[index]);
+        sparse_[entity_index(entity)] = index;
+        sparse_[entity_index(other)] = from;
+    }
+
+    /*
+    Stamp the component of an entity as changed, the entity must be in the set
+    @param entity: Entity's handle
+    @param tick: Tick of the change
+    */
+    void mark_changed(const Entity entity, const unsigned tick) noexcept
+    {
+        dense_ticks_[sparse_[entity_index(entity)]].changed = tick;
+    }
+
+    /*
+    Get the ticks of the component of an entity, the entity must be in the set
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] const ComponentTicks &get_ticks(const Entity entity) const noexcept
+    {
+        return dense_ticks_[sparse_[entity_index(entity)]];
+    }
+
+    // Entities whose component was removed since the last call to clear_removed
+    [[nodiscard]] const std::pmr::vector<Entity> &removed() const noexcept { return removed_; }
+
+    void clear_removed() noexcept { removed_.clear(); }
+
+    /*
+    Check if an entity has a component in this set, stale handles are never contained
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] bool contains(const Entity entity) const noexcept
+    {
+        const unsigned slot = entity_index(entity);
+        return slot < sparse_.size() && sparse_[slot] != INVALID_INDEX && dense_entities_[sparse_[slot]] == entity;
+    }
+
+    /*
+    Get the component of an entity, the entity must be in the set
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] T &get(const Entity entity) noexcept
+    {
+        return dense_components_[sparse_[entity_index(entity)]];
+    }
+
+    /*
+    Get the component of an entity, the entity must be in the set
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] const T &get(const Entity entity) const noexcept
+    {
+        return dense_components_[sparse_[entity_index(entity)]];
+    }
+
+    /*
+    Get the component of an entity, or nullptr if it has none
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] T *find(const Entity entity) noexcept
+    {
+        return contains(entity) ? &dense_components_[sparse_[entity_index(entity)]] : nullptr;
+    }
+
+    /*
+    Reserve memory for a number of components
+    @param capacity: Number of components
+    */
+    void reserve(const std::size_t capacity)
+    {
+        dense_entities_.reserve(capacity);
+        dense_components_.reserve(capacity);
+        dense_ticks_.reserve(capacity);
+    }
+
+    void clear() noexcept
+    {
+        sparse_.clear();
+        dense_entities_.clear();
+        dense_components_.clear();
+        dense_ticks_.clear();
+        removed_.clear();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return dense_entities_.size(); }
+    [[nodiscard]] bool empty() const noexcept { return dense_entities_.empty(); }
+
+    // Entities owning a component, in dense order
+    [[nodiscard]] const std::pmr::vector<Entity> &entities() const noexcept { return dense_entities_; }
+
+    // Components, in dense order
+    [[nodiscard]] T *data() noexcept { return dense_components_.data(); }
+    [[nodiscard]] const T *data() const noexcept { return dense_components_.data(); }
+
+    // Ticks of the components, in dense order
+    [[nodiscard]] const ComponentTicks *ticks() const noexcept { return dense_ticks_.data(); }
+
+    [[nodiscard]] typename std::pmr::vector<T>::iterator begin() noexcept { return dense_components_.begin(); }
+    [[nodiscard]] typename std::pmr::vector<T>::iterator end() noexcept { return dense_components_.end(); }
+    [[nodiscard]] typename std::pmr::vector<T>::const_iterator begin() const noexcept { return dense_components_.begin(); }
+    [[nodiscard]] typename std::pmr::vector<T>::const_iterator end() const noexcept { return dense_components_.end(); }
+
+private:
+    std::pmr::vector<unsigned> sparse_;
+    std::pmr::vector<Entity> dense_entities_;
+    std::pmr::vector<T> dense_components_;
+    std::pmr::vector<ComponentTicks> dense_ticks_;
+    std::pmr::vector<Entity> removed_;
+};
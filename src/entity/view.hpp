@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "archetype_storage.hpp"
+#include "sparse_set.hpp"
+
+/*
+Non-owning view over every entity that has all the given components
+Iterates in place over the smallest storage and hands out references, nothing is copied or allocated
+A const component type gives read-only access
+@param masks: Entities masks, used to skip excluded components and tags
+@param archetypes: Archetype storage to walk instead of the sparse sets, nullptr in sparse set mode
+@param storages: Storage of each component type
+*/
+template <typename... Ts>
+class View
+{
+    static_assert(sizeof...(Ts) > 0, "A view needs at least one component type");
+
+public:
+    View(const std::pmr::vector<Signature> &masks, ArchetypeStorage *archetypes, SparseSet<std::remove_const_t<Ts>> &...storages) noexcept
+        : masks_(&masks), archetypes_(archetypes), storages_(&storages...)
+    {
+    }
+
+    /*
+    Get a copy of the view that skips entities having any of the given components or tags
+    The test only reads the entity's mask, excluded components are never fetched
+    */
+    template <typename... Us>
+    [[nodiscard]] View exclude() const noexcept
+    {
+        View view = *this;
+        view.excluded_ |= component_mask<Us...>();
+        return view;
+    }
+
+    /*
+    Get a copy of the view that iterates a precomputed list of matching entities instead of searching them
+    Only used in sparse set mode, archetype chunks already group matching entities
+    @param entities: Entities matching the view, usually a QueryCache list
+    */
+    [[nodiscard]] View with_entities(const std::pmr::vector<Entity> &entities) const noexcept
+    {
+        View view = *this;
+        view.cached_ = &entities;
+        return view;
+    }
+
+    /*
+    Call a function on each matching entity
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename Func>
+    void each(Func &&func) const
+    {
+        // Only the chunks of matching archetypes are visited
+        if (archetypes_ != nullptr)
+        {
+            if (excluded_.none())
+            {
+                archetypes_->each<Ts...>(func);
+                return;
+            }
+
+            archetypes_->each<Ts...>([this, &func](const Entity entity, Ts &...components)
+                                     {
+                                         if (!is_excluded(entity))
+                                             func(entity, components...);
+                                     });
+            return;
+        }
+
+        // Every cached entity matches, no test is needed
+        if (cached_ != nullptr)
+        {
+            for (const Entity entity : *cached_)
+                func(entity, std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->get(entity)...);
+            return;
+        }
+
+        const std::pmr::vector<Entity> &entities = driver_entities();
+
+        for (std::size_t i = 0; i < entities.size(); ++i)
+        {
+            const Entity entity = entities[i];
+            if (!contains(entity))
+                continue;
+
+            func(entity, std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->get(entity)...);
+        }
+    }
+
+    /*
+    Call a function on each matching entity whose Tracked component changed since a tick
+    Adding a component counts as a change
+    @param since: Reference tick, usually the tick returned by the caller's last EntityManager::advance_tick
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename Tracked, typename Func>
+    void each_changed(const unsigned since, Func &&func) const
+    {
+        each_since<Tracked>(since, false, func);
+    }
+
+    /*
+    Call a function on each matching entity whose Tracked component was added since a tick
+    @param since: Reference tick, usually the tick returned by the caller's last EntityManager::advance_tick
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename Tracked, typename Func>
+    void each_added(const unsigned since, Func &&func) const
+    {
+        each_since<Tracked>(since, true, func);
+    }
+
+    /*
+    Check if an entity has every component of the view
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] bool contains(const Entity entity) const noexcept
+    {
+        if (archetypes_ != nullptr)
+            return (archetypes_->find<std::remove_const_t<Ts>>(entity) && ...) && !is_excluded(entity);
+
+        return (std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->contains(entity) && ...) && !is_excluded(entity);
+    }
+
+    // Upper bound of the number of entities visited
+    [[nodiscard]] std::size_t size_hint() const noexcept
+    {
+        if (archetypes_ != nullptr)
+            return archetypes_->count<std::remove_const_t<Ts>...>();
+
+        if (cached_ != nullptr)
+            return cached_->size();
+
+        return driver_entities().size();
+    }
+
+private:
+    const std::pmr::vector<Signature> *masks_ = nullptr;
+    ArchetypeStorage *archetypes_ = nullptr;
+    std::tuple<SparseSet<std::remove_const_t<Ts>> *...> storages_;
+    Signature excluded_;
+    const std::pmr::vector<Entity> *cached_ = nullptr;
+
+    /*
+    Check if an entity has an excluded component or tag
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] bool is_excluded(const Entity entity) const noexcept
+    {
+        return !excluded_.none() && (*masks_)[entity_index(entity)].intersects(excluded_);
+    }
+
+    /*
+    Call a function on each matching entity whose Tracked component was added or changed since a tick
+    @param since: Reference tick
+    @param added_only: Only visit components added since the tick
+    @param func: Callable as func(Entity entity, Ts &...components)
+    */
+    template <typename Tracked, typename Func>
+    void each_since(const unsigned since, const bool added_only, Func &func) const
+    {
+        static_assert((std::is_same_v<Tracked, std::remove_const_t<Ts>> || ...), "Tracked component must be part of the view");
+
+        if (archetypes_ != nullptr)
+        {
+            archetypes_->each_since<Ts...>(component_id<Tracked>(), since, added_only,
+                                           [this, &func](const Entity entity, Ts &...components)
+                                           {
+                                               if (!is_excluded(entity))
+                                                   func(entity, components...);
+                                           });
+            return;
+        }
+
+        const SparseSet<Tracked> &tracked = *std::get<SparseSet<Tracked> *>(storages_);
+        const std::pmr::vector<Entity> &entities = tracked.entities();
+        const ComponentTicks *ticks = tracked.ticks();
+
+        for (std::size_t i = 0; i < entities.size(); ++i)
+        {
+            if (!is_newer_tick(added_only ? ticks[i].added : ticks[i].changed, since))
+                continue;
+
+            const Entity entity = entities[i];
+            if (!contains(entity))
+                continue;
+
+            func(entity, std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->get(entity)...);
+        }
+    }
+
+    // Entities of the smallest storage, every match is among them
+    [[nodiscard]] const std::pmr::vector<Entity> &driver_entities() const noexcept
+    {
+        const std::pmr::vector<Entity> *smallest = nullptr;
+        ((smallest = (smallest == nullptr || std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->size() < smallest->size())
+                         ? &std::get<SparseSet<std::remove_const_t<Ts>> *>(storages_)->entities()
+                         : smallest),
+         ...);
+        return *smallest;
+    }
+};
@@ -1,161 +1,705 @@
 #include "entity_manager.hpp"
 
-// Create an entity and return its id
-[[nodiscard]] unsigned EntityManager::create_entity() noexcept
+/*
+Class that handles entities and their components
+Each component type allocates from its own counting memory resource, entity tables and queries share one more
+@param mode: How components are stored
+@param resource: Memory resource serving every allocation, nullptr for the built-in page pools (one per component type)
+*/
+EntityManager::EntityManager(const StorageMode mode, std::pmr::memory_resource *resource) : mode_(mode),
+                                                                                          counters_(make_counters(resource, std::make_index_sequence<RESOURCE_COUNT>{})),
+                                                                                          archetypes_(&counters_.back()),
+                                                                                          entity_masks_(&counters_.back()),
+                                                                                          entity_slots_(&counters_.back()),
+                                                                                          free_slots_(&counters_.back()),
+                                                                                          storages_(make_storages(std::make_index_sequence<COMPONENT_TYPE_COUNT>{})),
+                                                                                          queries_(&counters_.back()),
+                                                                                          change_lists_(&counters_.back()),
+                                                                                          reordering_(&counters_.back())
 {
-    unsigned entity_id = entity_count_;
-    entity_masks_[entity_id] = 0;
-    entity_count_++;
-    return entity_id;
+}
+
+// Create an entity and return its handle, slots of destroyed entities are recycled
+[[nodiscard]] Entity EntityManager::create_entity() noexcept
+{
+    const Entity entity = allocate_entity();
+    if (entity != NULL_ENTITY && mode_ == StorageMode::ARCHETYPE)
+        archetypes_.add_entity(entity);
+    return entity;
 }
 
 /*
-Add a PhysicsComponent to an entity
-@param entity: Entity's id
-@param component: Physics component
+Create many entities from a prefab and return their handles
+Storage grows once and components are copied in bulk
+@param prefab: Components given to every entity
+@param count: Number of entities to create
 */
-void EntityManager::add_component(const unsigned entity, const PhysicsComponent &component) noexcept
+std::vector<Entity> EntityManager::instantiate(const Prefab &prefab, const unsigned count)
 {
-    if (!key_exist(entity, entity_masks_))
-        return;
+    const Signature mask = prefab.get_mask();
+
+    // Reserve every slot at once, recycled slots are used first
+    const std::size_t new_slots = count > free_slots_.size() ? count - free_slots_.size() : 0;
+    entity_slots_.reserve(entity_slots_.size() + new_slots);
+    entity_masks_.reserve(entity_masks_.size() + new_slots);
 
-    physics_components_[entity] = component;
-    entity_masks_[entity] |= static_cast<unsigned>(ComponentType::PHYSICS);
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const Entity entity = allocate_entity();
+        if (entity == NULL_ENTITY)
+            break;
+
+        set_mask(entity, mask);
+        entities.push_back(entity);
+    }
+
+    if (mode_ == StorageMode::ARCHETYPE)
+    {
+        std::array<const void *, COMPONENT_TYPE_COUNT> prototypes{};
+        Components::for_each([this, &prefab, &prototypes, &entities](auto tag)
+                             {
+                                 using T = typename decltype(tag)::type;
+                                 if (prefab.get<T>())
+                                 {
+                                     prototypes[component_id<T>()] = &*prefab.get<T>();
+                                     record_changes(component_id<T>(), entities.data(), entities.size());
+                                 }
+                             });
+        archetypes_.add_entities(entities.data(), entities.size(), mask & STORED_COMPONENTS_MASK, prototypes, tick_);
+        return entities;
+    }
+
+    Components::for_each([this, &prefab, &entities](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             if (prefab.get<T>())
+                             {
+                                 get_storage<T>().insert(entities.data(), entities.size(), *prefab.get<T>(), tick_);
+                                 record_changes(component_id<T>(), entities.data(), entities.size());
+                             }
+                         });
+
+    return entities;
 }
 
 /*
-Add a TransformComponent to an entity
-@param entity: Entity's id
-@param component: Transform component
+Destroy an entity and all of its components
+Its handle becomes stale, returns false if it already was
+@param entity: Entity's handle
 */
-void EntityManager::add_component(const unsigned entity, const TransformComponent &component) noexcept
+bool EntityManager::destroy_entity(const Entity entity) noexcept
 {
-    if (!key_exist(entity, entity_masks_))
-        return;
+    if (!is_alive(entity))
+        return false;
+
+    const unsigned slot = entity_index(entity);
+
+    if (mode_ == StorageMode::ARCHETYPE)
+        archetypes_.remove_entity(entity);
+    else
+    {
+        std::apply([entity](auto &...storages)
+                   { (storages.remove(entity), ...); },
+                   storages_);
+    }
 
-    transform_components_[entity] = component;
-    entity_masks_[entity] |= static_cast<unsigned>(ComponentType::TRANSFORM);
+    // Free slots keep their next generation, with an index no handle can match
+    // A slot whose generation is saturated is retired, wrapping would let stale handles match again
+    set_mask(entity, Signature{});
+    const unsigned generation = entity_generation(entity);
+    if (generation == ENTITY_GENERATION_MASK)
+        entity_slots_[slot] = NULL_ENTITY;
+    else
+    {
+        entity_slots_[slot] = make_entity(ENTITY_INDEX_MASK, generation + 1);
+        free_slots_.push_back(slot);
+    }
+    entity_count_--;
+    return true;
 }
 
 /*
-Add a RenderComponent to an entity
-@param entity: Entity's id
-@param component: Render component
+Check if a handle refers to a living entity
+@param entity: Entity's handle
 */
-void EntityManager::add_component(const unsigned entity, const RenderComponent &component) noexcept
+[[nodiscard]] bool EntityManager::is_alive(const Entity entity) const noexcept
 {
-    if (!key_exist(entity, entity_masks_))
-        return;
+    const unsigned slot = entity_index(entity);
+    return slot < entity_slots_.size() && entity_slots_[slot] == entity;
+}
 
-    render_components_[entity] = component;
-    entity_masks_[entity] |= static_cast<unsigned>(ComponentType::RENDER);
+// Get the number of living entities
+[[nodiscard]] unsigned EntityManager::get_entity_count() const noexcept
+{
+    return entity_count_;
 }
 
 /*
-Add a ColliderComponent to an entity
-@param entity: Entity's id
-@param component: Collider component
+Get the entity mask of the given entity
+@param entity: Entity's handle
 */
-void EntityManager::add_component(const unsigned entity, const ColliderComponent &component) noexcept
+[[nodiscard]] Signature EntityManager::get_entity_mask(const Entity entity) const noexcept
 {
-    if (!key_exist(entity, entity_masks_))
-        return;
+    if (is_alive(entity))
+        return entity_masks_[entity_index(entity)];
+
+    std::cerr << "[ECS MANAGER WARNING]\n"
+              << "Could not find mask for entity " << entity << std::endl;
+    return Signature{};
+}
+
+// Get all entities masks, indexed by entity index (empty for free slots)
+[[nodiscard]] const std::pmr::vector<Signature> &EntityManager::get_masks() const noexcept
+{
+    return entity_masks_;
+}
+
+// Get the command buffer flushed by flush_commands, safe to record into while systems iterate
+[[nodiscard]] CommandBuffer &EntityManager::get_commands() noexcept
+{
+    return commands_;
+}
+
+// Apply every command recorded in the manager's command buffer, must not be called during iteration
+void EntityManager::flush_commands()
+{
+    apply_commands(commands_);
+}
 
-    collider_components_[entity] = component;
-    entity_masks_[entity] |= static_cast<unsigned>(ComponentType::COLLIDER);
+/*
+Apply every command recorded in a buffer in one batched pass, then clear it
+Commands are grouped by kind and sorted by entity so each storage is touched once
+@param buffer: Recorded commands
+*/
+void EntityManager::apply_commands(CommandBuffer &buffer)
+{
+    const std::lock_guard<std::mutex> lock(buffer.mutex_);
+
+    for (const Prefab &prefab : buffer.creates_)
+        instantiate(prefab, 1);
+    buffer.creates_.clear();
+
+    std::apply([this](auto &...adds)
+               { (apply_adds(adds), ...); },
+               buffer.adds_);
+
+    // Removes are recorded per component type so each storage is visited in one pass
+    Components::for_each([this, &buffer](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             apply_removes<T>(std::get<component_id<T>()>(buffer.removes_));
+                         });
+
+    // Destroying twice is harmless but sorting first removes duplicates cheaply
+    std::sort(buffer.destroys_.begin(), buffer.destroys_.end());
+    buffer.destroys_.erase(std::unique(buffer.destroys_.begin(), buffer.destroys_.end()), buffer.destroys_.end());
+    for (const Entity entity : buffer.destroys_)
+        destroy_entity(entity);
+    buffer.destroys_.clear();
+}
+
+// Get the current change tick, every component mutation is stamped with it
+[[nodiscard]] unsigned EntityManager::get_tick() const noexcept
+{
+    return tick_;
+}
+
+/*
+Start a new change tick and return the one that just ended
+A system stores the returned tick and passes it to each_changed / each_added on its next run,
+so it sees every change made after it ran but not its own
+*/
+unsigned EntityManager::advance_tick() noexcept
+{
+    return tick_++;
+}
+
+// Forget every removal recorded so far
+void EntityManager::clear_removed() noexcept
+{
+    archetypes_.clear_removed();
+    std::apply([](auto &...storages)
+               { (storages.clear_removed(), ...); },
+               storages_);
+}
+
+/*
+Get the entities recorded in a list of changes since it was last cleared, in order of the changes
+An entity is recorded once per change, it may have lost the component or been destroyed since
+@param list: List returned by track_changes
+*/
+[[nodiscard]] const std::pmr::vector<Entity> &EntityManager::get_changes(const unsigned list) const noexcept
+{
+    return change_lists_[list];
 }
 
 /*
-Remove a component from an entity
-@param entity: Entity's id
-@param component_type: Type of the component
+Forget every change recorded in a list
+@param list: List returned by track_changes
 */
-void EntityManager::remove_component(const unsigned entity, const ComponentType &component) noexcept
+void EntityManager::clear_changes(const unsigned list) noexcept
 {
-    switch (component)
+    change_lists_[list].clear();
+}
+
+/*
+Save every entity and component to a binary snapshot, returns false if the file could not be written
+In sparse set mode the dense arrays are written as-is, archetype mode gathers each component type first
+@param path: Path of the file, overwritten
+*/
+bool EntityManager::save_snapshot(const std::string &path)
+{
+    SnapshotWriter writer(path);
+    if (!writer.is_open())
     {
-    case ComponentType::TRANSFORM:
+        std::cerr << "[ECS MANAGER WARNING]\n"
+                  << "Could not create snapshot " << path << std::endl;
+        return false;
+    }
+
+    SnapshotHeader header;
+    header.slot_count = static_cast<std::uint32_t>(entity_slots_.size());
+    header.free_slot_count = static_cast<std::uint32_t>(free_slots_.size());
+    header.entity_count = entity_count_;
+    writer.write_header(header);
+    writer.write_section(entity_slots_.data(), entity_slots_.size());
+    writer.write_section(entity_masks_.data(), entity_masks_.size());
+    writer.write_section(free_slots_.data(), free_slots_.size());
+
+    Components::for_each([this, &writer](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             if (mode_ == StorageMode::SPARSE_SET)
+                             {
+                                 const SparseSet<T> &storage = get_storage<T>();
+                                 writer.write_section(storage.entities().data(), storage.size());
+                                 writer.write_section(storage.data(), storage.size());
+                                 return;
+                             }
+
+                             // Rows are spread over chunks, gather them in one array per type
+                             std::vector<Entity> entities;
+                             std::vector<T> components;
+                             view<const T>().each([&entities, &components](const Entity entity, const T &component)
+                                                  {
+                                                      entities.push_back(entity);
+                                                      components.push_back(component);
+                                                  });
+                             writer.write_section(entities.data(), entities.size());
+                             writer.write_section(components.data(), components.size());
+                         });
+
+    if (!writer.finish())
+    {
+        std::cerr << "[ECS MANAGER WARNING]\n"
+                  << "Could not write snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+Replace every entity and component with the content of a snapshot, returns false if it could not be loaded
+The file is memory mapped and its arrays copied in bulk, handles are the ones that were saved
+Loaded components are stamped as added at the current tick and replaced ones are reported as removed, so systems see the change
+Nothing changes if the file is invalid, must not be called during iteration
+@param path: Path of the file
+*/
+bool EntityManager::load_snapshot(const std::string &path)
+{
+    SnapshotReader reader(path);
+    const char *error = nullptr;
+
+    const SnapshotHeader *header = reader.read_header();
+    std::size_t slot_count = 0, mask_count = 0, free_count = 0;
+    const Entity *slots = header != nullptr ? reader.read_section<Entity>(slot_count) : nullptr;
+    const Signature *masks = slots != nullptr ? reader.read_section<Signature>(mask_count) : nullptr;
+    const unsigned *free_slots = masks != nullptr ? reader.read_section<unsigned>(free_count) : nullptr;
+    if (free_slots != nullptr && (slot_count != header->slot_count || mask_count != slot_count ||
+                                  free_count != header->free_slot_count || slot_count > MAX_ENTITIES))
+        error = "entity tables do not match the header";
+
+    // Every array is located and checked before anything is replaced
+    // seen holds, per slot, the last list that named it, to catch a slot listed twice
+    std::vector<std::size_t> seen(error == nullptr ? slot_count : 0, 0);
+    std::array<const Entity *, COMPONENT_TYPE_COUNT> component_entities{};
+    std::array<const void *, COMPONENT_TYPE_COUNT> component_data{};
+    std::array<std::size_t, COMPONENT_TYPE_COUNT> component_counts{};
+    bool valid = free_slots != nullptr && error == nullptr;
+    Components::for_each([&](auto tag)
+                         {
+                             using T = typename decltype(tag)::type;
+                             if (!valid)
+                                 return;
+
+                             std::size_t entity_count = 0, count = 0;
+                             const Entity *entities = reader.read_section<Entity>(entity_count);
+                             const T *components = entities != nullptr ? reader.read_section<T>(count) : nullptr;
+                             valid = components != nullptr && count == entity_count;
+                             if (components != nullptr && !valid)
+                                 error = "component arrays do not match";
+
+                             // Handles index the entity tables, a corrupted one must not reach them
+                             for (std::size_t i = 0; valid && i < count; ++i)
+                             {
+                                 const unsigned slot = entity_index(entities[i]);
+                                 valid = slot < slot_count && slots[slot] == entities[i] && masks[slot].test(component_id<T>());
+                                 if (!valid)
+                                     error = "component owned by a missing entity";
+                                 else if (seen[slot] == component_id<T>() + 1)
+                                 {
+                                     valid = false;
+                                     error = "entity listed twice in a component array";
+                                 }
+                                 else
+                                     seen[slot] = component_id<T>() + 1;
+                             }
+
+                             component_entities[component_id<T>()] = entities;
+                             component_data[component_id<T>()] = components;
+                             component_counts[component_id<T>()] = count;
+                         });
+    for (std::size_t i = 0; valid && i < free_count; ++i)
     {
-        if (key_exist(entity, transform_components_))
-            transform_components_.erase(entity);
-        break;
+        valid = free_slots[i] < slot_count && entity_index(slots[free_slots[i]]) != free_slots[i] && masks[free_slots[i]] == Signature{};
+        if (!valid)
+            error = "free slot held by an entity";
+        else if (seen[free_slots[i]] == COMPONENT_TYPE_COUNT + 1)
+        {
+            valid = false;
+            error = "free slot listed twice";
+        }
+        else
+            seen[free_slots[i]] = COMPONENT_TYPE_COUNT + 1;
     }
-    case ComponentType::PHYSICS:
+
+    // Retired slots are neither free nor live, so the live count is read from the slots themselves
+    std::size_t live_count = 0;
+    for (unsigned slot = 0; valid && slot < slot_count; ++slot)
+        live_count += entity_index(slots[slot]) == slot ? 1 : 0;
+    if (valid && live_count != header->entity_count)
     {
-        if (key_exist(entity, physics_components_))
-            physics_components_.erase(entity);
-        break;
+        valid = false;
+        error = "entity count does not match the header";
     }
-    case ComponentType::RENDER:
+
+    // Each component bit of a mask must be backed by exactly one component
+    std::array<std::size_t, COMPONENT_TYPE_COUNT> expected_counts{};
+    for (unsigned slot = 0; valid && slot < slot_count; ++slot)
     {
-        if (key_exist(entity, render_components_))
-            render_components_.erase(entity);
-        break;
+        for (std::size_t id = 0; id < COMPONENT_TYPE_COUNT; ++id)
+            expected_counts[id] += masks[slot].test(id) ? 1 : 0;
     }
-    case ComponentType::COLLIDER:
+    if (valid && expected_counts != component_counts)
     {
-        if (key_exist(entity, collider_components_))
-            collider_components_.erase(entity);
-        break;
+        valid = false;
+        error = "masks do not match the component arrays";
     }
-    default:
+
+    if (!valid)
+    {
         std::cerr << "[ECS MANAGER WARNING]\n"
-                  << "Unknown component type for removal\n";
-        break;
+                  << "Could not load snapshot " << path << ": " << (error != nullptr ? error : reader.get_error()) << std::endl;
+        return false;
     }
+
+    // Replaced entities are reported as removed, so systems caching them let go of them
+    if (mode_ == StorageMode::ARCHETYPE)
+    {
+        for (unsigned slot = 0; slot < entity_slots_.size(); ++slot)
+        {
+            if (entity_index(entity_slots_[slot]) == slot)
+                archetypes_.remove_entity(entity_slots_[slot]);
+        }
+    }
+
+    entity_slots_.assign(slots, slots + slot_count);
+    entity_masks_.assign(masks, masks + slot_count);
+    free_slots_.assign(free_slots, free_slots + free_count);
+    entity_count_ = static_cast<unsigned>(live_count);
+
+    if (mode_ == StorageMode::SPARSE_SET)
+    {
+        Components::for_each([&](auto tag)
+                             {
+                                 using T = typename decltype(tag)::type;
+                                 constexpr std::size_t id = component_id<T>();
+                                 get_storage<T>().assign(component_entities[id], static_cast<const T *>(component_data[id]),
+                                                         component_counts[id], tick_);
+                             });
+        queries_.rebuild(entity_masks_, entity_slots_);
+    }
+    else
+    {
+        // Dense index of each entity's component, so every entity is placed in its archetype in one copy
+        std::array<std::vector<unsigned>, COMPONENT_TYPE_COUNT> indices;
+        for (std::size_t id = 0; id < COMPONENT_TYPE_COUNT; ++id)
+        {
+            indices[id].assign(slot_count, 0);
+            for (std::size_t i = 0; i < component_counts[id]; ++i)
+                indices[id][entity_index(component_entities[id][i])] = static_cast<unsigned>(i);
+        }
+
+        for (unsigned slot = 0; slot < slot_count; ++slot)
+        {
+            if (entity_index(slots[slot]) != slot)
+                continue;
+
+            std::array<const void *, COMPONENT_TYPE_COUNT> prototypes{};
+            for (std::size_t id = 0; id < COMPONENT_TYPE_COUNT; ++id)
+            {
+                if (masks[slot].test(id))
+                    prototypes[id] = static_cast<const std::byte *>(component_data[id]) + indices[id][slot] * COMPONENT_SIZES[id];
+            }
+            archetypes_.add_entities(&slots[slot], 1, masks[slot] & STORED_COMPONENTS_MASK, prototypes, tick_);
+        }
+    }
+
+    for (std::size_t id = 0; id < COMPONENT_TYPE_COUNT; ++id)
+        record_changes(id, component_entities[id], component_counts[id]);
+
+    // Every pass and cached order refers to the replaced storage
+    mask_changes_++;
+    reordering_.order.clear();
+    reordering_.cursor = 0;
+    return true;
 }
 
 /*
-Get the entity mask of the given entity
-@param entity: Entity's id
+Enable the periodic spatial reordering of component storage, disabled by default
+Components are sorted by the Morton code of their entity's TransformComponent::position,
+so entities close in space are close in memory, handles are not affected
+@param period: Number of reorder_step calls between the end of a pass and the next one, 0 disables it
+@param budget: Maximum number of entities placed per reorder_step call
 */
-[[nodiscard]] unsigned EntityManager::get_entity_mask(const unsigned entity) const noexcept
+void EntityManager::set_spatial_reordering(const unsigned period, const unsigned budget) noexcept
 {
-    if (key_exist(entity, entity_masks_))
-        return entity_masks_.at(entity);
+    reordering_.period = period;
+    reordering_.budget = budget;
+    reordering_.countdown = 0;
+    reordering_.cursor = 0;
+    reordering_.order.clear();
+}
 
-    std::cerr << "[ECS MANAGER WARNING]\n"
-              << "Could not find mask for entity " << entity << std::endl;
-    return 0;
+/*
+Advance the spatial reordering by at most one budget of entities
+Must not be called during iteration, a pass restarts if an entity's mask changed since it began
+*/
+void EntityManager::reorder_step()
+{
+    if (reordering_.period == 0 || reordering_.budget == 0)
+        return;
+
+    // Adds and removes swap entities around, the target order would no longer hold
+    if (reordering_.cursor < reordering_.order.size() && reordering_.mask_changes != mask_changes_)
+        reordering_.order.clear();
+
+    if (reordering_.cursor >= reordering_.order.size())
+    {
+        if (reordering_.countdown > 0)
+        {
+            reordering_.countdown--;
+            return;
+        }
+        begin_reordering_pass();
+    }
+
+    // Entities are placed in order, each one goes to the next free index of its storages
+    const std::size_t end = std::min(reordering_.order.size(), reordering_.cursor + reordering_.budget);
+    for (; reordering_.cursor < end; ++reordering_.cursor)
+    {
+        const Entity entity = reordering_.order[reordering_.cursor];
+
+        if (mode_ == StorageMode::ARCHETYPE)
+        {
+            const ArchetypeStorage::EntityLocation location = archetypes_.get_location(entity);
+            archetypes_.swap_rows(location.archetype, location.row, reordering_.next_rows[location.archetype]++);
+            continue;
+        }
+
+        Components::for_each([this, entity](auto tag)
+                             {
+                                 using T = typename decltype(tag)::type;
+                                 SparseSet<T> &storage = get_storage<T>();
+                                 if (storage.contains(entity))
+                                     storage.move_to(entity, reordering_.next_indices[component_id<T>()]++);
+                             });
+    }
+
+    if (reordering_.cursor == reordering_.order.size())
+        end_reordering_pass();
 }
 
-// Get all entities masks
-[[nodiscard]] std::unordered_map<unsigned, unsigned> EntityManager::get_masks() const noexcept
+// Get how components are stored
+[[nodiscard]] StorageMode EntityManager::get_storage_mode() const noexcept
 {
-    return entity_masks_;
+    return mode_;
+}
+
+/*
+Get the allocation counters summed over every storage, table and query
+Two equal allocation counts around a frame mean it did not allocate
+*/
+[[nodiscard]] AllocationStats EntityManager::get_allocation_stats() const noexcept
+{
+    // Peaks are reached at different times, their sum is an upper bound
+    AllocationStats total;
+    for (const CountingResource &counter : counters_)
+    {
+        const AllocationStats &stats = counter.get_stats();
+        total.allocations += stats.allocations;
+        total.deallocations += stats.deallocations;
+        total.bytes_in_use += stats.bytes_in_use;
+        total.peak_bytes += stats.peak_bytes;
+    }
+    return total;
 }
 
 // Get all physics components
-[[nodiscard]] std::unordered_map<unsigned, PhysicsComponent> &EntityManager::get_physics() noexcept
+[[nodiscard]] SparseSet<PhysicsComponent> &EntityManager::get_physics() noexcept
 {
-    return physics_components_;
+    return get_storage<PhysicsComponent>();
 }
 
 // Get all transform components
-[[nodiscard]] std::unordered_map<unsigned, TransformComponent> &EntityManager::get_transforms() noexcept
+[[nodiscard]] SparseSet<TransformComponent> &EntityManager::get_transforms() noexcept
 {
-    return transform_components_;
+    return get_storage<TransformComponent>();
 }
 
 // Get all render components
-[[nodiscard]] std::unordered_map<unsigned, RenderComponent> &EntityManager::get_renders() noexcept
+[[nodiscard]] SparseSet<RenderComponent> &EntityManager::get_renders() noexcept
 {
-    return render_components_;
+    return get_storage<RenderComponent>();
 }
 
 // Get all collider components
-[[nodiscard]] std::unordered_map<unsigned, ColliderComponent> &EntityManager::get_colliders() noexcept
+[[nodiscard]] SparseSet<ColliderComponent> &EntityManager::get_colliders() noexcept
+{
+    return get_storage<ColliderComponent>();
+}
+
+// Sort entities with a transform by Morton code and start a new reordering pass
+void EntityManager::begin_reordering_pass()
+{
+    reordering_.order.clear();
+    reordering_.cursor = 0;
+    reordering_.mask_changes = mask_changes_;
+    reordering_.next_indices.fill(0);
+    reordering_.next_rows.assign(archetypes_.get_archetypes().size(), 0);
+
+    auto transforms = view<const TransformComponent>();
+    if (transforms.size_hint() == 0)
+        return;
+
+    // Quantize positions over the bounds of the scene
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    transforms.each([&min, &max]([[maybe_unused]] const Entity entity, const TransformComponent &transform)
+                    {
+                        for (int axis = 0; axis < 3; ++axis)
+                        {
+                            min[axis] = std::min(min[axis], transform.position[axis]);
+                            max[axis] = std::max(max[axis], transform.position[axis]);
+                        }
+                    });
+
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; ++axis)
+        scale[axis] = static_cast<float>((1u << MORTON_AXIS_BITS) - 1) / std::max(max[axis] - min[axis], 1e-6f);
+
+    std::pmr::vector<std::pair<std::uint64_t, Entity>> &codes = reordering_.codes;
+    codes.clear();
+    codes.reserve(transforms.size_hint());
+    transforms.each([&codes, &min, &scale](const Entity entity, const TransformComponent &transform)
+                    { codes.emplace_back(morton_code(transform.position, min, scale), entity); });
+
+    // Ties are broken by entity index so a pass is deterministic
+    std::sort(codes.begin(), codes.end(), [](const auto &a, const auto &b)
+              { return a.first != b.first ? a.first < b.first : entity_index(a.second) < entity_index(b.second); });
+
+    reordering_.order.reserve(codes.size());
+    for (const auto &[code, entity] : codes)
+        reordering_.order.push_back(entity);
+}
+
+// Sort the cached query lists in the order of the finished reordering pass
+void EntityManager::end_reordering_pass()
+{
+    if (mode_ == StorageMode::SPARSE_SET && queries_.size() > 0)
+    {
+        std::pmr::vector<unsigned> &ranks = reordering_.ranks;
+        ranks.assign(entity_slots_.size(), QueryCache::INVALID_INDEX);
+        for (std::size_t i = 0; i < reordering_.order.size(); ++i)
+            ranks[entity_index(reordering_.order[i])] = static_cast<unsigned>(i);
+        queries_.sort(ranks);
+    }
+
+    reordering_.order.clear();
+    reordering_.cursor = 0;
+    reordering_.countdown = reordering_.period;
+}
+
+// Take a free slot, or a new one, and return the entity's handle
+[[nodiscard]] Entity EntityManager::allocate_entity() noexcept
 {
-    return collider_components_;
+    unsigned slot = 0;
+    unsigned generation = 0;
+
+    if (!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        generation = entity_generation(entity_slots_[slot]);
+    }
+    else if (entity_slots_.size() < MAX_ENTITIES)
+    {
+        slot = static_cast<unsigned>(entity_slots_.size());
+        entity_slots_.push_back(NULL_ENTITY);
+        entity_masks_.emplace_back();
+    }
+    else
+    {
+        std::cerr << "[ECS MANAGER WARNING]\n"
+                  << "Maximum number of entities reached\n";
+        return NULL_ENTITY;
+    }
+
+    const Entity entity = make_entity(slot, generation);
+    entity_slots_[slot] = entity;
+    entity_masks_[slot] = Signature{};
+    entity_count_++;
+    return entity;
+}
+
+/*
+Change the mask of an entity and keep the cached queries up to date
+@param entity: Entity's handle
+@param mask: New mask
+*/
+void EntityManager::set_mask(const Entity entity, const Signature &mask)
+{
+    Signature &current = entity_masks_[entity_index(entity)];
+    if (current == mask)
+        return;
+
+    // Archetype views never read the cached lists
+    if (mode_ == StorageMode::SPARSE_SET)
+        queries_.on_mask_changed(entity, current, mask);
+    current = mask;
+    mask_changes_++;
 }
 
 /*
-Check if entity id is stored in the given component map
-@param id: Entity's id
-@param component_map: Map of components
+Record a change of the components of many entities in the lists tracking their type
+@param component: Component type index
+@param entities: Entities' handles
+@param count: Number of entities
 */
-template <class T>
-[[nodiscard]] bool EntityManager::key_exist(const unsigned id, const std::unordered_map<unsigned, T> &component_map) const noexcept
+void EntityManager::record_changes(const std::size_t component, const Entity *entities, const std::size_t count)
 {
-    return component_map.find(id) != component_map.end();
+    for (const unsigned list : change_listeners_[component])
+        change_lists_[list].insert(change_lists_[list].end(), entities, entities + count);
 }
\ No newline at end of file
@@ -1,89 +1,549 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
-#include <unordered_map>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "archetype_storage.hpp"
+#include "command_buffer.hpp"
 #include "components.hpp"
+#include "entity.hpp"
+#include "memory_resources.hpp"
+#include "morton.hpp"
+#include "prefab.hpp"
+#include "query_cache.hpp"
+#include "snapshot.hpp"
+#include "sparse_set.hpp"
+#include "view.hpp"
+
+/*
+How components are stored
+SPARSE_SET: one dense array per component type
+ARCHETYPE: entities with the same mask share fixed-size SoA chunks
+*/
+enum class StorageMode
+{
+    SPARSE_SET,
+    ARCHETYPE,
+};
 
 /*
 Class that handles entities and their components
+Each component type allocates from its own counting memory resource, entity tables and queries share one more
+@param mode: How components are stored
+@param resource: Memory resource serving every allocation, nullptr for the built-in page pools (one per component type)
 */
 class EntityManager
 {
 public:
-    // Create an entity and return its id
-    [[nodiscard]] unsigned create_entity() noexcept;
+    EntityManager(const StorageMode mode = StorageMode::SPARSE_SET, std::pmr::memory_resource *resource = nullptr);
+    EntityManager(const EntityManager &) = delete;
+    EntityManager &operator=(const EntityManager &) = delete;
+
+    // Create an entity and return its handle, slots of destroyed entities are recycled
+    [[nodiscard]] Entity create_entity() noexcept;
 
     /*
-    Add a PhysicsComponent to an entity
-    @param entity: Entity's id
-    @param component: Physics component
+    Create many entities from a prefab and return their handles
+    Storage grows once and components are copied in bulk
+    @param prefab: Components given to every entity
+    @param count: Number of entities to create
     */
-    void add_component(const unsigned entity, const PhysicsComponent &component) noexcept;
+    std::vector<Entity> instantiate(const Prefab &prefab, const unsigned count);
 
     /*
-    Add a TransformComponent to an entity
-    @param entity: Entity's id
-    @param component: Transform component
+    Create many entities from a prefab, then call an initializer on each of them
+    @param prefab: Components given to every entity
+    @param count: Number of entities to create
+    @param init: Callable as init(unsigned instance, PrefabInstance &components)
     */
-    void add_component(const unsigned entity, const TransformComponent &component) noexcept;
+    template <typename Func>
+    std::vector<Entity> instantiate(const Prefab &prefab, const unsigned count, Func &&init)
+    {
+        std::vector<Entity> entities = instantiate(prefab, count);
+
+        for (unsigned i = 0; i < entities.size(); ++i)
+        {
+            PrefabInstance instance;
+            instance.entity = entities[i];
+            Components::for_each([this, &prefab, &instance](auto tag)
+                                 {
+                                     using T = typename decltype(tag)::type;
+                                     if (prefab.get<T>())
+                                         std::get<component_id<T>()>(instance.components) = get_component<T>(instance.entity);
+                                 });
+            init(i, instance);
+        }
+
+        return entities;
+    }
 
     /*
-    Add a RenderComponent to an entity
-    @param entity: Entity's id
-    @param component: Render component
+    Destroy an entity and all of its components
+    Its handle becomes stale, returns false if it already was
+    @param entity: Entity's handle
     */
-    void add_component(const unsigned entity, const RenderComponent &component) noexcept;
+    bool destroy_entity(const Entity entity) noexcept;
 
     /*
-    Add a ColliderComponent to an entity
-    @param entity: Entity's id
-    @param component: Collider component
+    Check if a handle refers to a living entity
+    @param entity: Entity's handle
     */
-    void add_component(const unsigned entity, const ColliderComponent &component) noexcept;
+    [[nodiscard]] bool is_alive(const Entity entity) const noexcept;
+
+    // Get the number of living entities
+    [[nodiscard]] unsigned get_entity_count() const noexcept;
+
+    /*
+    Add a component to an entity, or overwrite the existing one
+    @param entity: Entity's handle
+    @param component: Component of a type listed in Components
+    */
+    template <typename T>
+    void add_component(const Entity entity, const T &component) noexcept
+    {
+        if (!is_alive(entity))
+            return;
+
+        store_component(entity, component);
+    }
 
     /*
     Remove a component from an entity
-    @param entity: Entity's id
-    @param component_type: Type of the component
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    void remove_component(const Entity entity) noexcept
+    {
+        if (!is_alive(entity))
+            return;
+
+        const bool removed = mode_ == StorageMode::ARCHETYPE ? archetypes_.remove(entity, component_id<T>())
+                                                             : get_storage<T>().remove(entity);
+
+        // Systems rely on the mask to know which components can be accessed
+        if (removed)
+            set_mask(entity, Signature(entity_masks_[entity_index(entity)]).reset(component_id<T>()));
+    }
+
+    /*
+    Add a tag to an entity, only its mask changes
+    @param entity: Entity's handle
     */
-    void remove_component(const unsigned entity, const ComponentType &component_type) noexcept;
+    template <typename T>
+    void add_tag(const Entity entity)
+    {
+        if (is_alive(entity))
+            set_mask(entity, Signature(entity_masks_[entity_index(entity)]).set(tag_id<T>()));
+    }
+
+    /*
+    Remove a tag from an entity, only its mask changes
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    void remove_tag(const Entity entity)
+    {
+        if (is_alive(entity))
+            set_mask(entity, Signature(entity_masks_[entity_index(entity)]).reset(tag_id<T>()));
+    }
+
+    /*
+    Check if an entity has a tag
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    [[nodiscard]] bool has_tag(const Entity entity) const noexcept
+    {
+        return is_alive(entity) && entity_masks_[entity_index(entity)].test(tag_id<T>());
+    }
 
     /*
     Get the entity mask of the given entity
-    @param entity: Entity's id
+    @param entity: Entity's handle
+    */
+    [[nodiscard]] Signature get_entity_mask(const Entity entity) const noexcept;
+
+    // Get all entities masks, indexed by entity index (empty for free slots)
+    [[nodiscard]] const std::pmr::vector<Signature> &get_masks() const noexcept;
+
+    /*
+    Get a view over every entity that has all the given components
+    Use a const component type for read-only access
+    */
+    template <typename... Ts>
+    [[nodiscard]] View<Ts...> view() noexcept
+    {
+        ArchetypeStorage *archetypes = mode_ == StorageMode::ARCHETYPE ? &archetypes_ : nullptr;
+        return View<Ts...>(entity_masks_, archetypes, get_storage<std::remove_const_t<Ts>>()...);
+    }
+
+    /*
+    Get a view backed by a persistent list of matching entities, for queries run every step
+    The list is built the first time a signature is queried, then updated whenever a mask changes
+    In archetype mode this is a plain view with exclusions, chunks already group matching entities
+    @param exclude: Components and tags the entities must not have
+    */
+    template <typename... Ts, typename... Us>
+    [[nodiscard]] View<Ts...> query(Exclude<Us...> = {})
+    {
+        const View<Ts...> filtered = view<Ts...>().template exclude<Us...>();
+        if (mode_ == StorageMode::ARCHETYPE)
+            return filtered;
+
+        const unsigned index = queries_.get_or_register(component_mask<std::remove_const_t<Ts>...>(), component_mask<Us...>(),
+                                                        entity_masks_, entity_slots_);
+        return filtered.with_entities(queries_.entities(index));
+    }
+
+    /*
+    Get the component of an entity, or nullptr if it has none
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    [[nodiscard]] T *get_component(const Entity entity) noexcept
+    {
+        if (!is_alive(entity))
+            return nullptr;
+
+        if (mode_ == StorageMode::ARCHETYPE)
+            return archetypes_.find<T>(entity);
+
+        return get_storage<T>().find(entity);
+    }
+
+    // Get the command buffer flushed by flush_commands, safe to record into while systems iterate
+    [[nodiscard]] CommandBuffer &get_commands() noexcept;
+
+    // Apply every command recorded in the manager's command buffer, must not be called during iteration
+    void flush_commands();
+
+    /*
+    Apply every command recorded in a buffer in one batched pass, then clear it
+    Commands are grouped by kind and sorted by entity so each storage is touched once
+    @param buffer: Recorded commands
+    */
+    void apply_commands(CommandBuffer &buffer);
+
+    // Get the current change tick, every component mutation is stamped with it
+    [[nodiscard]] unsigned get_tick() const noexcept;
+
+    /*
+    Start a new change tick and return the one that just ended
+    A system stores the returned tick and passes it to each_changed / each_added on its next run,
+    so it sees every change made after it ran but not its own
     */
-    [[nodiscard]] unsigned get_entity_mask(const unsigned entity) const noexcept;
+    unsigned advance_tick() noexcept;
 
-    // Get all entities masks
-    [[nodiscard]] std::unordered_map<unsigned, unsigned> get_masks() const noexcept;
+    /*
+    Stamp the component of an entity as changed, for writes made through references
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    void mark_changed(const Entity entity) noexcept
+    {
+        if (!is_alive(entity))
+            return;
 
-    // Get all physics components
-    [[nodiscard]] std::unordered_map<unsigned, PhysicsComponent> &get_physics() noexcept;
+        if (mode_ == StorageMode::ARCHETYPE)
+        {
+            if (archetypes_.find<T>(entity) == nullptr)
+                return;
+            archetypes_.mark_changed<T>(entity, tick_);
+        }
+        else
+        {
+            if (!get_storage<T>().contains(entity))
+                return;
+            get_storage<T>().mark_changed(entity, tick_);
+        }
 
-    // Get all transform components
-    [[nodiscard]] std::unordered_map<unsigned, TransformComponent> &get_transforms() noexcept;
+        record_change<T>(entity);
+    }
 
-    // Get all render components
-    [[nodiscard]] std::unordered_map<unsigned, RenderComponent> &get_renders() noexcept;
+    /*
+    Get the added and changed ticks of the component of an entity, or nullptr if it has none
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    [[nodiscard]] const ComponentTicks *get_ticks(const Entity entity) noexcept
+    {
+        if (!is_alive(entity))
+            return nullptr;
+
+        if (mode_ == StorageMode::ARCHETYPE)
+            return archetypes_.find_ticks<T>(entity);
 
-    // Get all collider components
-    [[nodiscard]] std::unordered_map<unsigned, ColliderComponent> &get_colliders() noexcept;
+        return get_storage<T>().contains(entity) ? &get_storage<T>().get_ticks(entity) : nullptr;
+    }
+
+    // Get the entities whose T component was removed (or destroyed) since the last clear_removed
+    template <typename T>
+    [[nodiscard]] const std::pmr::vector<Entity> &get_removed() noexcept
+    {
+        if (mode_ == StorageMode::ARCHETYPE)
+            return archetypes_.removed(component_id<T>());
+
+        return get_storage<T>().removed();
+    }
+
+    // Forget every removal recorded so far
+    void clear_removed() noexcept;
+
+    /*
+    Start recording the entities whose T component is added or changed, the ones that already have it are recorded first
+    Returns the list they are recorded in, read and cleared by the one system tracking it, so it never scans every component
+    */
+    template <typename T>
+    [[nodiscard]] unsigned track_changes()
+    {
+        const unsigned list = static_cast<unsigned>(change_lists_.size());
+        change_lists_.emplace_back();
+        view<const T>().each([this, list](const Entity entity, [[maybe_unused]] const T &component)
+                             { change_lists_[list].push_back(entity); });
+        change_listeners_[component_id<T>()].push_back(list);
+        return list;
+    }
+
+    /*
+    Get the entities recorded in a list of changes since it was last cleared, in order of the changes
+    An entity is recorded once per change, it may have lost the component or been destroyed since
+    @param list: List returned by track_changes
+    */
+    [[nodiscard]] const std::pmr::vector<Entity> &get_changes(const unsigned list) const noexcept;
+
+    /*
+    Forget every change recorded in a list
+    @param list: List returned by track_changes
+    */
+    void clear_changes(const unsigned list) noexcept;
+
+    /*
+    Save every entity and component to a binary snapshot, returns false if the file could not be written
+    In sparse set mode the dense arrays are written as-is, archetype mode gathers each component type first
+    @param path: Path of the file, overwritten
+    */
+    bool save_snapshot(const std::string &path);
+
+    /*
+    Replace every entity and component with the content of a snapshot, returns false if it could not be loaded
+    The file is memory mapped and its arrays copied in bulk, handles are the ones that were saved
+    Loaded components are stamped as added at the current tick and replaced ones are reported as removed, so systems see the change
+    Nothing changes if the file is invalid, must not be called during iteration
+    @param path: Path of the file
+    */
+    bool load_snapshot(const std::string &path);
+
+    /*
+    Enable the periodic spatial reordering of component storage, disabled by default
+    Components are sorted by the Morton code of their entity's TransformComponent::position,
+    so entities close in space are close in memory, handles are not affected
+    @param period: Number of reorder_step calls between the end of a pass and the next one, 0 disables it
+    @param budget: Maximum number of entities placed per reorder_step call
+    */
+    void set_spatial_reordering(const unsigned period, const unsigned budget) noexcept;
+
+    /*
+    Advance the spatial reordering by at most one budget of entities
+    Must not be called during iteration, a pass restarts if an entity's mask changed since it began
+    */
+    void reorder_step();
+
+    // Get how components are stored
+    [[nodiscard]] StorageMode get_storage_mode() const noexcept;
+
+    // Get the allocation counters of a component type's storage, zero in archetype mode
+    template <typename T>
+    [[nodiscard]] const AllocationStats &get_allocation_stats() const noexcept
+    {
+        return counters_[component_id<T>()].get_stats();
+    }
+
+    /*
+    Get the allocation counters summed over every storage, table and query
+    Two equal allocation counts around a frame mean it did not allocate
+    */
+    [[nodiscard]] AllocationStats get_allocation_stats() const noexcept;
+
+    // Get the storage of a component type, empty in archetype mode
+    template <typename T>
+    [[nodiscard]] SparseSet<T> &get_storage() noexcept
+    {
+        return std::get<component_id<T>()>(storages_);
+    }
+
+    // Get all physics components, empty in archetype mode
+    [[nodiscard]] SparseSet<PhysicsComponent> &get_physics() noexcept;
+
+    // Get all transform components, empty in archetype mode
+    [[nodiscard]] SparseSet<TransformComponent> &get_transforms() noexcept;
+
+    // Get all render components, empty in archetype mode
+    [[nodiscard]] SparseSet<RenderComponent> &get_renders() noexcept;
+
+    // Get all collider components, empty in archetype mode
+    [[nodiscard]] SparseSet<ColliderComponent> &get_colliders() noexcept;
 
 private:
-    std::unordered_map<unsigned, unsigned> entity_masks_;
-    std::unordered_map<unsigned, PhysicsComponent> physics_components_;
-    std::unordered_map<unsigned, TransformComponent> transform_components_;
-    std::unordered_map<unsigned, RenderComponent> render_components_;
-    std::unordered_map<unsigned, ColliderComponent> collider_components_;
+    // One resource per component type, the last one serves archetypes, entity tables and queries
+    static constexpr std::size_t RESOURCE_COUNT = COMPONENT_TYPE_COUNT + 1;
+
+    StorageMode mode_ = StorageMode::SPARSE_SET;
+
+    // Must be declared before every container allocating from them
+    std::array<PagePoolResource, RESOURCE_COUNT> pools_;
+    std::array<CountingResource, RESOURCE_COUNT> counters_;
+
+    ArchetypeStorage archetypes_;
+    std::pmr::vector<Signature> entity_masks_;
+    std::pmr::vector<Entity> entity_slots_;
+    std::pmr::vector<unsigned> free_slots_;
+    Components::Map<SparseSet> storages_;
+    QueryCache queries_;
 
     unsigned entity_count_ = 0;
+    unsigned tick_ = 1;
+
+    // Incremented on every mask change, lets the spatial reordering detect structural changes
+    unsigned mask_changes_ = 0;
+
+    // Entities whose component was added or changed, one list per tracking system
+    std::pmr::vector<std::pmr::vector<Entity>> change_lists_;
+
+    // Lists recording the changes of each component type
+    std::array<std::vector<unsigned>, COMPONENT_TYPE_COUNT> change_listeners_;
+
+    // State of the spatial reordering, a pass places entities in Morton order a budget at a time
+    struct SpatialReordering
+    {
+        explicit SpatialReordering(std::pmr::memory_resource *resource) : order(resource), next_rows(resource), codes(resource), ranks(resource)
+        {
+        }
+
+        unsigned period = 0;
+        unsigned budget = 0;
+        unsigned countdown = 0;
+        unsigned mask_changes = 0;
+        std::size_t cursor = 0;
+        std::pmr::vector<Entity> order;
+
+        // Next dense index to fill in each sparse set, or next row in each archetype
+        std::array<unsigned, COMPONENT_TYPE_COUNT> next_indices{};
+        std::pmr::vector<unsigned> next_rows;
+
+        // Scratch buffers kept between passes so a pass does not allocate once the scene stopped growing
+        std::pmr::vector<std::pair<std::uint64_t, Entity>> codes;
+        std::pmr::vector<unsigned> ranks;
+    } reordering_;
+
+    CommandBuffer commands_;
 
     /*
-    Check if entity id is stored in the given component map
-    @param id: Entity's id
-    @param component_map: Map of components
+    Apply recorded component adds, in entity order, the last recorded value wins
+    @param adds: Recorded entities and components
     */
     template <typename T>
-    [[nodiscard]] bool key_exist(const unsigned id, const std::unordered_map<unsigned, T> &component_map) const noexcept;
+    void apply_adds(std::vector<std::pair<Entity, T>> &adds)
+    {
+        std::stable_sort(adds.begin(), adds.end(), [](const auto &a, const auto &b)
+                         { return entity_index(a.first) < entity_index(b.first); });
+
+        for (const auto &[entity, component] : adds)
+        {
+            if (is_alive(entity))
+                store_component(entity, component);
+        }
+        adds.clear();
+    }
+
+    /*
+    Apply recorded component removes, in entity order
+    @param removes: Recorded entities
+    */
+    template <typename T>
+    void apply_removes(std::vector<Entity> &removes)
+    {
+        std::stable_sort(removes.begin(), removes.end(), [](const Entity a, const Entity b)
+                         { return entity_index(a) < entity_index(b); });
+
+        for (const Entity entity : removes)
+            remove_component<T>(entity);
+        removes.clear();
+    }
+
+    /*
+    Make the counting resources, each one forwarding to the given resource or to its page pool
+    @param resource: Memory resource serving every allocation, nullptr for the page pools
+    */
+    template <std::size_t... Is>
+    [[nodiscard]] std::array<CountingResource, RESOURCE_COUNT> make_counters(std::pmr::memory_resource *resource, std::index_sequence<Is...>) noexcept
+    {
+        return {CountingResource(resource != nullptr ? resource : &pools_[Is])...};
+    }
+
+    // Make the sparse sets, each one allocating from its component type's resource
+    template <std::size_t... Is>
+    [[nodiscard]] Components::Map<SparseSet> make_storages(std::index_sequence<Is...>)
+    {
+        return Components::Map<SparseSet>(std::tuple_element_t<Is, Components::Map<SparseSet>>(&counters_[Is])...);
+    }
+
+    // Take a free slot, or a new one, and return the entity's handle
+    [[nodiscard]] Entity allocate_entity() noexcept;
+
+    // Sort entities with a transform by Morton code and start a new reordering pass
+    void begin_reordering_pass();
+
+    // Sort the cached query lists in the order of the finished reordering pass
+    void end_reordering_pass();
+
+    /*
+    Change the mask of an entity and keep the cached queries up to date
+    @param entity: Entity's handle
+    @param mask: New mask
+    */
+    void set_mask(const Entity entity, const Signature &mask);
+
+    /*
+    Store a component of an entity in the active storage and update its mask
+    @param entity: Entity's handle
+    @param component: Component to store
+    */
+    template <typename T>
+    void store_component(const Entity entity, const T &component)
+    {
+        if (mode_ == StorageMode::ARCHETYPE)
+            archetypes_.set(entity, component, tick_);
+        else
+            get_storage<T>().emplace(entity, component, tick_);
+
+        set_mask(entity, Signature(entity_masks_[entity_index(entity)]).set(component_id<T>()));
+        record_change<T>(entity);
+    }
+
+    /*
+    Record a change of the component of an entity in the lists tracking its type
+    @param entity: Entity's handle
+    */
+    template <typename T>
+    void record_change(const Entity entity)
+    {
+        for (const unsigned list : change_listeners_[component_id<T>()])
+            change_lists_[list].push_back(entity);
+    }
+
+    /*
+    Record a change of the components of many entities in the lists tracking their type
+    @param component: Component type index
+    @param entities: Entities' handles
+    @param count: Number of entities
+    */
+    void record_changes(const std::size_t component, const Entity *entities, const std::size_t count);
 };
\ No newline at end of file
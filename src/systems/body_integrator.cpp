@@ -0,0 +1,912 @@
+#include "body_integrator.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BODY_INTEGRATOR_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+/*
+Kernels are compiled for their instruction set only, the rest of the program keeps the default target
+Multiplies and adds must not be fused, or the paths would round differently
+*/
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#define BODY_INTEGRATOR_NO_CONTRACT
+#define BODY_INTEGRATOR_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__GNUC__)
+#define BODY_INTEGRATOR_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#define BODY_INTEGRATOR_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#else
+#define BODY_INTEGRATOR_NO_CONTRACT
+#define BODY_INTEGRATOR_TARGET(isa)
+#endif
+
+/*
+Raw pointers to the arrays of a batch, taken once per step
+@param bodies: Bodies to point to
+@param begin: Body the pointers start at
+*/
+struct BodyPointers
+{
+    explicit BodyPointers(BodyBatch &bodies, const std::size_t begin = 0) noexcept : inv_mass(bodies.inv_mass.data() + begin)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            position[axis] = bodies.position[axis].data() + begin;
+            linear_velocity[axis] = bodies.linear_velocity[axis].data() + begin;
+            force[axis] = bodies.force[axis].data() + begin;
+            angular_velocity[axis] = bodies.angular_velocity[axis].data() + begin;
+            torque[axis] = bodies.torque[axis].data() + begin;
+        }
+        for (std::size_t axis = 0; axis < 3; ++axis)
+            inv_inertia[axis] = bodies.inv_inertia[axis].data() + begin;
+        for (std::size_t component = 0; component < 4; ++component)
+            orientation[component] = bodies.orientation[component].data() + begin;
+    }
+
+    float *position[3];
+    float *linear_velocity[3];
+    float *force[3];
+    float *inv_mass;
+    float *angular_velocity[3];
+    float *torque[3];
+    float *orientation[4];
+    float *inv_inertia[3];
+};
+
+/*
+Integrate bodies one at a time, reference path and tail of the SIMD paths
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param linear: Also integrate linear motion, otherwise only angular motion
+@param begin: First body
+@param end: One past the last body
+*/
+BODY_INTEGRATOR_NO_CONTRACT
+static void integrate_scalar(const BodyPointers &bodies, const float dt, const bool linear, const std::size_t begin, const std::size_t end) noexcept
+{
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        if (linear)
+        {
+            for (std::size_t axis = 0; axis < 3; ++axis)
+            {
+                const float velocity = bodies.linear_velocity[axis][i] + bodies.force[axis][i] * bodies.inv_mass[i] * dt;
+                bodies.linear_velocity[axis][i] = velocity;
+                bodies.force[axis][i] = 0.0f;
+                bodies.position[axis][i] += velocity * dt;
+            }
+        }
+
+        // Rotation from local to world space, column-major like glm::mat3_cast
+        const float qx = bodies.orientation[0][i];
+        const float qy = bodies.orientation[1][i];
+        const float qz = bodies.orientation[2][i];
+        const float qw = bodies.orientation[3][i];
+        float rotation[9];
+        {
+            const float xx = qx * qx, yy = qy * qy, zz = qz * qz;
+            const float xy = qx * qy, xz = qx * qz, yz = qy * qz;
+            const float wx = qw * qx, wy = qw * qy, wz = qw * qz;
+            rotation[0] = 1.0f - 2.0f * (yy + zz);
+            rotation[1] = 2.0f * (xy + wz);
+            rotation[2] = 2.0f * (xz - wy);
+            rotation[3] = 2.0f * (xy - wz);
+            rotation[4] = 1.0f - 2.0f * (xx + zz);
+            rotation[5] = 2.0f * (yz + wx);
+            rotation[6] = 2.0f * (xz + wy);
+            rotation[7] = 2.0f * (yz - wx);
+            rotation[8] = 1.0f - 2.0f * (xx + yy);
+        }
+
+        // World inverse inertia applied as R * (I^-1 * (R^T * torque)), I^-1 being diagonal in local space
+        float local[3];
+        for (std::size_t column = 0; column < 3; ++column)
+        {
+            local[column] = (rotation[column * 3] * bodies.torque[0][i] + rotation[column * 3 + 1] * bodies.torque[1][i] +
+                             rotation[column * 3 + 2] * bodies.torque[2][i]) *
+                            bodies.inv_inertia[column][i];
+        }
+        for (std::size_t row = 0; row < 3; ++row)
+        {
+            const float acceleration = rotation[row] * local[0] + rotation[3 + row] * local[1] + rotation[6 + row] * local[2];
+            bodies.angular_velocity[row][i] += acceleration * dt;
+            bodies.torque[row][i] = 0.0f;
+        }
+
+        // Orientation from the new angular velocity, q += 0.5 * dt * (w, 0) * q, then renormalized
+        const float ax = bodies.angular_velocity[0][i];
+        const float ay = bodies.angular_velocity[1][i];
+        const float az = bodies.angular_velocity[2][i];
+        const float half_step = 0.5f * dt;
+        const float x = qx + (ax * qw + (ay * qz - az * qy)) * half_step;
+        const float y = qy + (ay * qw + (az * qx - ax * qz)) * half_step;
+        const float z = qz + (az * qw + (ax * qy - ay * qx)) * half_step;
+        const float w = qw + (0.0f - (ax * qx + ay * qy + az * qz)) * half_step;
+        const float inv_length = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+        bodies.orientation[0][i] = x * inv_length;
+        bodies.orientation[1][i] = y * inv_length;
+        bodies.orientation[2][i] = z * inv_length;
+        bodies.orientation[3][i] = w * inv_length;
+    }
+}
+
+#ifdef BODY_INTEGRATOR_X86
+
+/*
+Integrate bodies four at a time, returns the number of bodies integrated
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param linear: Also integrate linear motion, otherwise only angular motion
+@param count: Number of bodies
+*/
+BODY_INTEGRATOR_TARGET("sse2")
+static std::size_t integrate_sse(const BodyPointers &bodies, const float dt, const bool linear, const std::size_t count) noexcept
+{
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 half_step = _mm_set1_ps(0.5f * dt);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        if (linear)
+        {
+            const __m128 inv_mass = _mm_loadu_ps(bodies.inv_mass + i);
+            for (std::size_t axis = 0; axis < 3; ++axis)
+            {
+                const __m128 acceleration = _mm_mul_ps(_mm_loadu_ps(bodies.force[axis] + i), inv_mass);
+                const __m128 velocity = _mm_add_ps(_mm_loadu_ps(bodies.linear_velocity[axis] + i), _mm_mul_ps(acceleration, step));
+                _mm_storeu_ps(bodies.linear_velocity[axis] + i, velocity);
+                _mm_storeu_ps(bodies.force[axis] + i, zero);
+                _mm_storeu_ps(bodies.position[axis] + i, _mm_add_ps(_mm_loadu_ps(bodies.position[axis] + i), _mm_mul_ps(velocity, step)));
+            }
+        }
+
+        // Rotation from local to world space, column-major like glm::mat3_cast
+        const __m128 qx = _mm_loadu_ps(bodies.orientation[0] + i);
+        const __m128 qy = _mm_loadu_ps(bodies.orientation[1] + i);
+        const __m128 qz = _mm_loadu_ps(bodies.orientation[2] + i);
+        const __m128 qw = _mm_loadu_ps(bodies.orientation[3] + i);
+        __m128 rotation[9];
+        {
+            const __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+            const __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+            const __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+            rotation[0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+            rotation[1] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+            rotation[2] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+            rotation[3] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+            rotation[4] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+            rotation[5] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+            rotation[6] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+            rotation[7] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+            rotation[8] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+        }
+
+        // World inverse inertia applied as R * (I^-1 * (R^T * torque)), I^-1 being diagonal in local space
+        const __m128 tx = _mm_loadu_ps(bodies.torque[0] + i);
+        const __m128 ty = _mm_loadu_ps(bodies.torque[1] + i);
+        const __m128 tz = _mm_loadu_ps(bodies.torque[2] + i);
+        __m128 local[3];
+        for (std::size_t column = 0; column < 3; ++column)
+        {
+            __m128 projected = _mm_mul_ps(rotation[column * 3], tx);
+            projected = _mm_add_ps(projected, _mm_mul_ps(rotation[column * 3 + 1], ty));
+            projected = _mm_add_ps(projected, _mm_mul_ps(rotation[column * 3 + 2], tz));
+            local[column] = _mm_mul_ps(projected, _mm_loadu_ps(bodies.inv_inertia[column] + i));
+        }
+        __m128 angular_velocity[3];
+        for (std::size_t row = 0; row < 3; ++row)
+        {
+            __m128 acceleration = _mm_mul_ps(rotation[row], local[0]);
+            acceleration = _mm_add_ps(acceleration, _mm_mul_ps(rotation[3 + row], local[1]));
+            acceleration = _mm_add_ps(acceleration, _mm_mul_ps(rotation[6 + row], local[2]));
+            angular_velocity[row] = _mm_add_ps(_mm_loadu_ps(bodies.angular_velocity[row] + i), _mm_mul_ps(acceleration, step));
+            _mm_storeu_ps(bodies.angular_velocity[row] + i, angular_velocity[row]);
+            _mm_storeu_ps(bodies.torque[row] + i, zero);
+        }
+
+        // Orientation from the new angular velocity, q += 0.5 * dt * (w, 0) * q, then renormalized
+        const __m128 ax = angular_velocity[0], ay = angular_velocity[1], az = angular_velocity[2];
+        const __m128 x = _mm_add_ps(qx, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ax, qw), _mm_sub_ps(_mm_mul_ps(ay, qz), _mm_mul_ps(az, qy))), half_step));
+        const __m128 y = _mm_add_ps(qy, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ay, qw), _mm_sub_ps(_mm_mul_ps(az, qx), _mm_mul_ps(ax, qz))), half_step));
+        const __m128 z = _mm_add_ps(qz, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(az, qw), _mm_sub_ps(_mm_mul_ps(ax, qy), _mm_mul_ps(ay, qx))), half_step));
+        const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, qx), _mm_mul_ps(ay, qy)), _mm_mul_ps(az, qz));
+        const __m128 w = _mm_add_ps(qw, _mm_mul_ps(_mm_sub_ps(zero, dot), half_step));
+        __m128 length_squared = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+        length_squared = _mm_add_ps(length_squared, _mm_mul_ps(z, z));
+        length_squared = _mm_add_ps(length_squared, _mm_mul_ps(w, w));
+        const __m128 inv_length = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+        _mm_storeu_ps(bodies.orientation[0] + i, _mm_mul_ps(x, inv_length));
+        _mm_storeu_ps(bodies.orientation[1] + i, _mm_mul_ps(y, inv_length));
+        _mm_storeu_ps(bodies.orientation[2] + i, _mm_mul_ps(z, inv_length));
+        _mm_storeu_ps(bodies.orientation[3] + i, _mm_mul_ps(w, inv_length));
+    }
+    return i;
+}
+
+/*
+Integrate bodies eight at a time, returns the number of bodies integrated
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param linear: Also integrate linear motion, otherwise only angular motion
+@param count: Number of bodies
+*/
+BODY_INTEGRATOR_TARGET("avx2")
+static std::size_t integrate_avx2(const BodyPointers &bodies, const float dt, const bool linear, const std::size_t count) noexcept
+{
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 half_step = _mm256_set1_ps(0.5f * dt);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        if (linear)
+        {
+            const __m256 inv_mass = _mm256_loadu_ps(bodies.inv_mass + i);
+            for (std::size_t axis = 0; axis < 3; ++axis)
+            {
+                const __m256 acceleration = _mm256_mul_ps(_mm256_loadu_ps(bodies.force[axis] + i), inv_mass);
+                const __m256 velocity = _mm256_add_ps(_mm256_loadu_ps(bodies.linear_velocity[axis] + i), _mm256_mul_ps(acceleration, step));
+                _mm256_storeu_ps(bodies.linear_velocity[axis] + i, velocity);
+                _mm256_storeu_ps(bodies.force[axis] + i, zero);
+                _mm256_storeu_ps(bodies.position[axis] + i, _mm256_add_ps(_mm256_loadu_ps(bodies.position[axis] + i), _mm256_mul_ps(velocity, step)));
+            }
+        }
+
+        // Rotation from local to world space, column-major like glm::mat3_cast
+        const __m256 qx = _mm256_loadu_ps(bodies.orientation[0] + i);
+        const __m256 qy = _mm256_loadu_ps(bodies.orientation[1] + i);
+        const __m256 qz = _mm256_loadu_ps(bodies.orientation[2] + i);
+        const __m256 qw = _mm256_loadu_ps(bodies.orientation[3] + i);
+        __m256 rotation[9];
+        {
+            const __m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+            const __m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+            const __m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+            rotation[0] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz)));
+            rotation[1] = _mm256_mul_ps(two, _mm256_add_ps(xy, wz));
+            rotation[2] = _mm256_mul_ps(two, _mm256_sub_ps(xz, wy));
+            rotation[3] = _mm256_mul_ps(two, _mm256_sub_ps(xy, wz));
+            rotation[4] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz)));
+            rotation[5] = _mm256_mul_ps(two, _mm256_add_ps(yz, wx));
+            rotation[6] = _mm256_mul_ps(two, _mm256_add_ps(xz, wy));
+            rotation[7] = _mm256_mul_ps(two, _mm256_sub_ps(yz, wx));
+            rotation[8] = _mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy)));
+        }
+
+        // World inverse inertia applied as R * (I^-1 * (R^T * torque)), I^-1 being diagonal in local space
+        const __m256 tx = _mm256_loadu_ps(bodies.torque[0] + i);
+        const __m256 ty = _mm256_loadu_ps(bodies.torque[1] + i);
+        const __m256 tz = _mm256_loadu_ps(bodies.torque[2] + i);
+        __m256 local[3];
+        for (std::size_t column = 0; column < 3; ++column)
+        {
+            __m256 projected = _mm256_mul_ps(rotation[column * 3], tx);
+            projected = _mm256_add_ps(projected, _mm256_mul_ps(rotation[column * 3 + 1], ty));
+            projected = _mm256_add_ps(projected, _mm256_mul_ps(rotation[column * 3 + 2], tz));
+            local[column] = _mm256_mul_ps(projected, _mm256_loadu_ps(bodies.inv_inertia[column] + i));
+        }
+        __m256 angular_velocity[3];
+        for (std::size_t row = 0; row < 3; ++row)
+        {
+            __m256 acceleration = _mm256_mul_ps(rotation[row], local[0]);
+            acceleration = _mm256_add_ps(acceleration, _mm256_mul_ps(rotation[3 + row], local[1]));
+            acceleration = _mm256_add_ps(acceleration, _mm256_mul_ps(rotation[6 + row], local[2]));
+            angular_velocity[row] = _mm256_add_ps(_mm256_loadu_ps(bodies.angular_velocity[row] + i), _mm256_mul_ps(acceleration, step));
+            _mm256_storeu_ps(bodies.angular_velocity[row] + i, angular_velocity[row]);
+            _mm256_storeu_ps(bodies.torque[row] + i, zero);
+        }
+
+        // Orientation from the new angular velocity, q += 0.5 * dt * (w, 0) * q, then renormalized
+        const __m256 ax = angular_velocity[0], ay = angular_velocity[1], az = angular_velocity[2];
+        const __m256 x = _mm256_add_ps(qx, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ax, qw), _mm256_sub_ps(_mm256_mul_ps(ay, qz), _mm256_mul_ps(az, qy))), half_step));
+        const __m256 y = _mm256_add_ps(qy, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ay, qw), _mm256_sub_ps(_mm256_mul_ps(az, qx), _mm256_mul_ps(ax, qz))), half_step));
+        const __m256 z = _mm256_add_ps(qz, _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(az, qw), _mm256_sub_ps(_mm256_mul_ps(ax, qy), _mm256_mul_ps(ay, qx))), half_step));
+        const __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, qx), _mm256_mul_ps(ay, qy)), _mm256_mul_ps(az, qz));
+        const __m256 w = _mm256_add_ps(qw, _mm256_mul_ps(_mm256_sub_ps(zero, dot), half_step));
+        __m256 length_squared = _mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        length_squared = _mm256_add_ps(length_squared, _mm256_mul_ps(z, z));
+        length_squared = _mm256_add_ps(length_squared, _mm256_mul_ps(w, w));
+        const __m256 inv_length = _mm256_div_ps(one, _mm256_sqrt_ps(length_squared));
+        _mm256_storeu_ps(bodies.orientation[0] + i, _mm256_mul_ps(x, inv_length));
+        _mm256_storeu_ps(bodies.orientation[1] + i, _mm256_mul_ps(y, inv_length));
+        _mm256_storeu_ps(bodies.orientation[2] + i, _mm256_mul_ps(z, inv_length));
+        _mm256_storeu_ps(bodies.orientation[3] + i, _mm256_mul_ps(w, inv_length));
+    }
+    return i;
+}
+
+/*
+Integrate bodies sixteen at a time, returns the number of bodies integrated
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param linear: Also integrate linear motion, otherwise only angular motion
+@param count: Number of bodies
+*/
+BODY_INTEGRATOR_TARGET("avx512f")
+static std::size_t integrate_avx512(const BodyPointers &bodies, const float dt, const bool linear, const std::size_t count) noexcept
+{
+    const __m512 step = _mm512_set1_ps(dt);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 half_step = _mm512_set1_ps(0.5f * dt);
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        if (linear)
+        {
+            const __m512 inv_mass = _mm512_loadu_ps(bodies.inv_mass + i);
+            for (std::size_t axis = 0; axis < 3; ++axis)
+            {
+                const __m512 acceleration = _mm512_mul_ps(_mm512_loadu_ps(bodies.force[axis] + i), inv_mass);
+                const __m512 velocity = _mm512_add_ps(_mm512_loadu_ps(bodies.linear_velocity[axis] + i), _mm512_mul_ps(acceleration, step));
+                _mm512_storeu_ps(bodies.linear_velocity[axis] + i, velocity);
+                _mm512_storeu_ps(bodies.force[axis] + i, zero);
+                _mm512_storeu_ps(bodies.position[axis] + i, _mm512_add_ps(_mm512_loadu_ps(bodies.position[axis] + i), _mm512_mul_ps(velocity, step)));
+            }
+        }
+
+        // Rotation from local to world space, column-major like glm::mat3_cast
+        const __m512 qx = _mm512_loadu_ps(bodies.orientation[0] + i);
+        const __m512 qy = _mm512_loadu_ps(bodies.orientation[1] + i);
+        const __m512 qz = _mm512_loadu_ps(bodies.orientation[2] + i);
+        const __m512 qw = _mm512_loadu_ps(bodies.orientation[3] + i);
+        __m512 rotation[9];
+        {
+            const __m512 xx = _mm512_mul_ps(qx, qx), yy = _mm512_mul_ps(qy, qy), zz = _mm512_mul_ps(qz, qz);
+            const __m512 xy = _mm512_mul_ps(qx, qy), xz = _mm512_mul_ps(qx, qz), yz = _mm512_mul_ps(qy, qz);
+            const __m512 wx = _mm512_mul_ps(qw, qx), wy = _mm512_mul_ps(qw, qy), wz = _mm512_mul_ps(qw, qz);
+            rotation[0] = _mm512_sub_ps(one, _mm512_mul_ps(two, _mm512_add_ps(yy, zz)));
+            rotation[1] = _mm512_mul_ps(two, _mm512_add_ps(xy, wz));
+            rotation[2] = _mm512_mul_ps(two, _mm512_sub_ps(xz, wy));
+            rotation[3] = _mm512_mul_ps(two, _mm512_sub_ps(xy, wz));
+            rotation[4] = _mm512_sub_ps(one, _mm512_mul_ps(two, _mm512_add_ps(xx, zz)));
+            rotation[5] = _mm512_mul_ps(two, _mm512_add_ps(yz, wx));
+            rotation[6] = _mm512_mul_ps(two, _mm512_add_ps(xz, wy));
+            rotation[7] = _mm512_mul_ps(two, _mm512_sub_ps(yz, wx));
+            rotation[8] = _mm512_sub_ps(one, _mm512_mul_ps(two, _mm512_add_ps(xx, yy)));
+        }
+
+        // World inverse inertia applied as R * (I^-1 * (R^T * torque)), I^-1 being diagonal in local space
+        const __m512 tx = _mm512_loadu_ps(bodies.torque[0] + i);
+        const __m512 ty = _mm512_loadu_ps(bodies.torque[1] + i);
+        const __m512 tz = _mm512_loadu_ps(bodies.torque[2] + i);
+        __m512 local[3];
+        for (std::size_t column = 0; column < 3; ++column)
+        {
+            __m512 projected = _mm512_mul_ps(rotation[column * 3], tx);
+            projected = _mm512_add_ps(projected, _mm512_mul_ps(rotation[column * 3 + 1], ty));
+            projected = _mm512_add_ps(projected, _mm512_mul_ps(rotation[column * 3 + 2], tz));
+            local[column] = _mm512_mul_ps(projected, _mm512_loadu_ps(bodies.inv_inertia[column] + i));
+        }
+        __m512 angular_velocity[3];
+        for (std::size_t row = 0; row < 3; ++row)
+        {
+            __m512 acceleration = _mm512_mul_ps(rotation[row], local[0]);
+            acceleration = _mm512_add_ps(acceleration, _mm512_mul_ps(rotation[3 + row], local[1]));
+            acceleration = _mm512_add_ps(acceleration, _mm512_mul_ps(rotation[6 + row], local[2]));
+            angular_velocity[row] = _mm512_add_ps(_mm512_loadu_ps(bodies.angular_velocity[row] + i), _mm512_mul_ps(acceleration, step));
+            _mm512_storeu_ps(bodies.angular_velocity[row] + i, angular_velocity[row]);
+            _mm512_storeu_ps(bodies.torque[row] + i, zero);
+        }
+
+        // Orientation from the new angular velocity, q += 0.5 * dt * (w, 0) * q, then renormalized
+        const __m512 ax = angular_velocity[0], ay = angular_velocity[1], az = angular_velocity[2];
+        const __m512 x = _mm512_add_ps(qx, _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(ax, qw), _mm512_sub_ps(_mm512_mul_ps(ay, qz), _mm512_mul_ps(az, qy))), half_step));
+        const __m512 y = _mm512_add_ps(qy, _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(ay, qw), _mm512_sub_ps(_mm512_mul_ps(az, qx), _mm512_mul_ps(ax, qz))), half_step));
+        const __m512 z = _mm512_add_ps(qz, _mm512_mul_ps(_mm512_add_ps(_mm512_mul_ps(az, qw), _mm512_sub_ps(_mm512_mul_ps(ax, qy), _mm512_mul_ps(ay, qx))), half_step));
+        const __m512 dot = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ax, qx), _mm512_mul_ps(ay, qy)), _mm512_mul_ps(az, qz));
+        const __m512 w = _mm512_add_ps(qw, _mm512_mul_ps(_mm512_sub_ps(zero, dot), half_step));
+        __m512 length_squared = _mm512_add_ps(_mm512_mul_ps(x, x), _mm512_mul_ps(y, y));
+        length_squared = _mm512_add_ps(length_squared, _mm512_mul_ps(z, z));
+        length_squared = _mm512_add_ps(length_squared, _mm512_mul_ps(w, w));
+        // Zero-masked form, GCC 12 reports the undefined source of _mm512_sqrt_ps as uninitialized
+        const __m512 inv_length = _mm512_div_ps(one, _mm512_maskz_sqrt_ps(0xffff, length_squared));
+        _mm512_storeu_ps(bodies.orientation[0] + i, _mm512_mul_ps(x, inv_length));
+        _mm512_storeu_ps(bodies.orientation[1] + i, _mm512_mul_ps(y, inv_length));
+        _mm512_storeu_ps(bodies.orientation[2] + i, _mm512_mul_ps(z, inv_length));
+        _mm512_storeu_ps(bodies.orientation[3] + i, _mm512_mul_ps(w, inv_length));
+    }
+    return i;
+}
+
+/*
+Run CPUID
+@param leaf: Function number
+@param subleaf: Sub-function number
+@param registers: Set to eax, ebx, ecx and edx
+*/
+static void cpuid(const unsigned leaf, const unsigned subleaf, unsigned registers[4]) noexcept
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+        registers[i] = static_cast<unsigned>(info[i]);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Get the register states the OS saves on context switches (XCR0)
+static unsigned long long get_enabled_states() noexcept
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned low = 0, high = 0;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return static_cast<unsigned long long>(high) << 32 | low;
+#endif
+}
+
+#endif
+
+// Get the widest instruction set supported by the CPU and enabled by the OS, checked with CPUID
+[[nodiscard]] SimdLevel detect_simd_level() noexcept
+{
+#ifdef BODY_INTEGRATOR_X86
+    unsigned registers[4] = {};
+    cpuid(0, 0, registers);
+    const unsigned max_leaf = registers[0];
+
+    cpuid(1, 0, registers);
+    const bool sse2 = (registers[3] >> 26) & 1;
+    const bool os_saves_states = (registers[2] >> 27) & 1;
+    const bool avx = (registers[2] >> 28) & 1;
+    if (!sse2)
+        return SimdLevel::SCALAR;
+    if (!os_saves_states || !avx || max_leaf < 7)
+        return SimdLevel::SSE;
+
+    // The OS must save the YMM registers, and the opmask and ZMM registers for AVX-512
+    const unsigned long long states = get_enabled_states();
+    if ((states & 0x6) != 0x6)
+        return SimdLevel::SSE;
+
+    cpuid(7, 0, registers);
+    const bool avx2 = (registers[1] >> 5) & 1;
+    const bool avx512 = (registers[1] >> 16) & 1;
+    if (avx512 && (states & 0xe6) == 0xe6)
+        return SimdLevel::AVX512;
+    return avx2 ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+/*
+Get the name of an instruction set, for logs
+@param level: Instruction set
+*/
+[[nodiscard]] const char *get_simd_level_name(const SimdLevel level) noexcept
+{
+    switch (level)
+    {
+    case SimdLevel::SSE:
+        return "SSE";
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::AVX512:
+        return "AVX-512";
+    default:
+        return "scalar";
+    }
+}
+
+/*
+Get the name of an integrator, for logs
+@param integrator: Integrator
+*/
+[[nodiscard]] const char *get_integrator_name(const Integrator integrator) noexcept
+{
+    switch (integrator)
+    {
+    case Integrator::VELOCITY_VERLET:
+        return "velocity Verlet";
+    case Integrator::RK4:
+        return "RK4";
+    default:
+        return "symplectic Euler";
+    }
+}
+
+// Remove every body, capacity is kept
+void BodyBatch::clear() noexcept
+{
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        position[axis].clear();
+        linear_velocity[axis].clear();
+        force[axis].clear();
+        angular_velocity[axis].clear();
+        torque[axis].clear();
+    }
+    inv_mass.clear();
+    for (BodyArray &element : orientation)
+        element.clear();
+    for (BodyArray &element : inv_inertia)
+        element.clear();
+}
+
+/*
+Append a body
+@param position: Position
+@param linear_velocity: Linear velocity
+@param force: Accumulated force
+@param inv_mass: Inverse mass
+@param angular_velocity: Angular velocity
+@param torque: Accumulated torque
+@param orientation: Unit quaternion, from local to world space
+@param inv_inertia: Diagonal of the inverse inertia tensor, in local space
+*/
+void BodyBatch::push_back(const glm::vec3 &position, const glm::vec3 &linear_velocity, const glm::vec3 &force, const float inv_mass,
+                          const glm::vec3 &angular_velocity, const glm::vec3 &torque, const glm::quat &orientation, const glm::vec3 &inv_inertia)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        this->position[axis].push_back(position[axis]);
+        this->linear_velocity[axis].push_back(linear_velocity[axis]);
+        this->force[axis].push_back(force[axis]);
+        this->angular_velocity[axis].push_back(angular_velocity[axis]);
+        this->torque[axis].push_back(torque[axis]);
+        this->inv_inertia[axis].push_back(inv_inertia[axis]);
+    }
+    this->inv_mass.push_back(inv_mass);
+    this->orientation[0].push_back(orientation.x);
+    this->orientation[1].push_back(orientation.y);
+    this->orientation[2].push_back(orientation.z);
+    this->orientation[3].push_back(orientation.w);
+}
+
+/*
+Set the number of bodies, new bodies must then be written with set
+@param count: Number of bodies
+*/
+void BodyBatch::resize(const std::size_t count)
+{
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        position[axis].resize(count);
+        linear_velocity[axis].resize(count);
+        force[axis].resize(count);
+        angular_velocity[axis].resize(count);
+        torque[axis].resize(count);
+        inv_inertia[axis].resize(count);
+    }
+    inv_mass.resize(count);
+    for (BodyArray &element : orientation)
+        element.resize(count);
+}
+
+/*
+Overwrite a body, bodies can be written from several threads
+@param index: Body's index
+@param position: Position
+@param linear_velocity: Linear velocity
+@param force: Accumulated force
+@param inv_mass: Inverse mass
+@param angular_velocity: Angular velocity
+@param torque: Accumulated torque
+@param orientation: Unit quaternion, from local to world space
+@param inv_inertia: Diagonal of the inverse inertia tensor, in local space
+*/
+void BodyBatch::set(const std::size_t index, const glm::vec3 &position, const glm::vec3 &linear_velocity, const glm::vec3 &force, const float inv_mass,
+                    const glm::vec3 &angular_velocity, const glm::vec3 &torque, const glm::quat &orientation, const glm::vec3 &inv_inertia) noexcept
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        this->position[axis][index] = position[axis];
+        this->linear_velocity[axis][index] = linear_velocity[axis];
+        this->force[axis][index] = force[axis];
+        this->angular_velocity[axis][index] = angular_velocity[axis];
+        this->torque[axis][index] = torque[axis];
+        this->inv_inertia[axis][index] = inv_inertia[axis];
+    }
+    this->inv_mass[index] = inv_mass;
+    this->orientation[0][index] = orientation.x;
+    this->orientation[1][index] = orientation.y;
+    this->orientation[2][index] = orientation.z;
+    this->orientation[3][index] = orientation.w;
+}
+
+// Number of bodies
+[[nodiscard]] std::size_t BodyBatch::size() const noexcept
+{
+    return inv_mass.size();
+}
+
+/*
+Get the position of a body
+@param index: Body's index
+*/
+[[nodiscard]] glm::vec3 BodyBatch::get_position(const std::size_t index) const noexcept
+{
+    return {position[0][index], position[1][index], position[2][index]};
+}
+
+/*
+Get the linear velocity of a body
+@param index: Body's index
+*/
+[[nodiscard]] glm::vec3 BodyBatch::get_linear_velocity(const std::size_t index) const noexcept
+{
+    return {linear_velocity[0][index], linear_velocity[1][index], linear_velocity[2][index]};
+}
+
+/*
+Get the angular velocity of a body
+@param index: Body's index
+*/
+[[nodiscard]] glm::vec3 BodyBatch::get_angular_velocity(const std::size_t index) const noexcept
+{
+    return {angular_velocity[0][index], angular_velocity[1][index], angular_velocity[2][index]};
+}
+
+/*
+Get the orientation of a body
+@param index: Body's index
+*/
+[[nodiscard]] glm::quat BodyBatch::get_orientation(const std::size_t index) const noexcept
+{
+    return glm::quat(orientation[3][index], orientation[0][index], orientation[1][index], orientation[2][index]);
+}
+
+/*
+Run the kernel of an instruction set on a range of bodies, then the scalar path on the remaining ones
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+@param linear: Also integrate linear motion, otherwise only angular motion
+@param begin: First body
+@param end: One past the last body
+*/
+static void dispatch(BodyBatch &bodies, const float dt, const SimdLevel level, const bool linear, const std::size_t begin, const std::size_t end) noexcept
+{
+    if (begin >= end)
+        return;
+
+    const BodyPointers pointers(bodies, begin);
+    const std::size_t count = end - begin;
+    std::size_t done = 0;
+
+#ifdef BODY_INTEGRATOR_X86
+    if (level == SimdLevel::AVX512)
+        done = integrate_avx512(pointers, dt, linear, count);
+    else if (level == SimdLevel::AVX2)
+        done = integrate_avx2(pointers, dt, linear, count);
+    else if (level == SimdLevel::SSE)
+        done = integrate_sse(pointers, dt, linear, count);
+#else
+    static_cast<void>(level);
+#endif
+
+    integrate_scalar(pointers, dt, linear, done, count);
+}
+
+/*
+Integrate velocities, positions and orientations of every body over a step, then clear forces and torques
+Semi-implicit Euler: velocities first, positions and orientations from the new velocities
+Every path performs the same operations in the same order, without fused multiply-add
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+*/
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level) noexcept
+{
+    dispatch(bodies, dt, level, true, 0, bodies.size());
+}
+
+/*
+Integrate velocities, positions and orientations of a range of bodies over a step, then clear their forces and torques
+Results do not depend on the range, ranges can run in parallel
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+@param begin: First body
+@param end: One past the last body
+*/
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level, const std::size_t begin, const std::size_t end) noexcept
+{
+    dispatch(bodies, dt, level, true, begin, end);
+}
+
+/*
+Integrate angular velocities and orientations of every body over a step, then clear torques
+Linear motion is left to the caller, for the multi-stage integrators
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+*/
+void integrate_angular(BodyBatch &bodies, const float dt, const SimdLevel level) noexcept
+{
+    dispatch(bodies, dt, level, false, 0, bodies.size());
+}
+
+/*
+Integrate angular velocities and orientations of a range of bodies over a step, then clear their torques
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+@param begin: First body
+@param end: One past the last body
+*/
+void integrate_angular(BodyBatch &bodies, const float dt, const SimdLevel level, const std::size_t begin, const std::size_t end) noexcept
+{
+    dispatch(bodies, dt, level, false, begin, end);
+}
+
+/*
+Get the number of force evaluations of an integrator in a step
+@param integrator: Integrator
+*/
+[[nodiscard]] unsigned get_stage_count(const Integrator integrator) noexcept
+{
+    switch (integrator)
+    {
+    case Integrator::VELOCITY_VERLET:
+        return 2;
+    case Integrator::RK4:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// Arrays of BodyBatch::stages, three per quantity
+enum StageArray : std::size_t
+{
+    BASE_FORCE = 0,
+    START_POSITION = 3,
+    START_VELOCITY = 6,
+    // Acceleration at the start (velocity Verlet), or weighted sum of the position derivatives (RK4)
+    ACCUMULATOR = 9,
+    // Weighted sum of the velocity derivatives (RK4)
+    VELOCITY_ACCUMULATOR = 12,
+};
+
+/*
+Save the state at the start of a step for a multi-stage integrator, forces must hold the constant forces only
+@param bodies: Bodies to integrate
+*/
+void begin_stages(BodyBatch &bodies)
+{
+    resize_stages(bodies);
+    begin_stages(bodies, 0, bodies.size());
+}
+
+/*
+Size the stage arrays of a multi-stage integrator, before saving the start of a step range by range
+@param bodies: Bodies to integrate
+*/
+void resize_stages(BodyBatch &bodies)
+{
+    for (BodyArray &stage : bodies.stages)
+        stage.resize(bodies.size());
+}
+
+/*
+Save the state of a range of bodies at the start of a step, the stage arrays must be sized
+@param bodies: Bodies to integrate
+@param begin: First body
+@param end: One past the last body
+*/
+void begin_stages(BodyBatch &bodies, const std::size_t begin, const std::size_t end) noexcept
+{
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        std::copy(bodies.force[axis].begin() + begin, bodies.force[axis].begin() + end, bodies.stages[BASE_FORCE + axis].begin() + begin);
+        std::copy(bodies.position[axis].begin() + begin, bodies.position[axis].begin() + end, bodies.stages[START_POSITION + axis].begin() + begin);
+        std::copy(bodies.linear_velocity[axis].begin() + begin, bodies.linear_velocity[axis].begin() + end,
+                  bodies.stages[START_VELOCITY + axis].begin() + begin);
+        std::fill(bodies.stages[ACCUMULATOR + axis].begin() + begin, bodies.stages[ACCUMULATOR + axis].begin() + end, 0.0f);
+        std::fill(bodies.stages[VELOCITY_ACCUMULATOR + axis].begin() + begin, bodies.stages[VELOCITY_ACCUMULATOR + axis].begin() + end, 0.0f);
+    }
+}
+
+/*
+Consume the forces evaluated for a stage and move the bodies to the state of the next one
+Returns false after the last stage, linear motion is then integrated and forces are cleared
+@param bodies: Bodies to integrate
+@param integrator: VELOCITY_VERLET or RK4
+@param stage: Index of the stage, from 0
+@param dt: Delta time
+*/
+bool advance_stage(BodyBatch &bodies, const Integrator integrator, const unsigned stage, const float dt) noexcept
+{
+    advance_stage(bodies, integrator, stage, dt, 0, bodies.size());
+    return stage + 1 < get_stage_count(integrator);
+}
+
+/*
+Consume the forces evaluated for a stage and move a range of bodies to the state of the next one
+@param bodies: Bodies to integrate
+@param integrator: VELOCITY_VERLET or RK4
+@param stage: Index of the stage, from 0
+@param dt: Delta time
+@param begin: First body
+@param end: One past the last body
+*/
+void advance_stage(BodyBatch &bodies, const Integrator integrator, const unsigned stage, const float dt,
+                   const std::size_t begin, const std::size_t end) noexcept
+{
+    // RK4 weights of each derivative, and fraction of the step where the next one is evaluated
+    static constexpr float RK4_WEIGHTS[4] = {1.0f, 2.0f, 2.0f, 1.0f};
+    static constexpr float RK4_OFFSETS[3] = {0.5f, 0.5f, 1.0f};
+
+    const float *inv_mass = bodies.inv_mass.data();
+    const bool last = stage + 1 >= get_stage_count(integrator);
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        float *position = bodies.position[axis].data();
+        float *velocity = bodies.linear_velocity[axis].data();
+        float *force = bodies.force[axis].data();
+        const float *base_force = bodies.stages[BASE_FORCE + axis].data();
+        const float *start_position = bodies.stages[START_POSITION + axis].data();
+        const float *start_velocity = bodies.stages[START_VELOCITY + axis].data();
+        float *accumulator = bodies.stages[ACCUMULATOR + axis].data();
+        float *velocity_accumulator = bodies.stages[VELOCITY_ACCUMULATOR + axis].data();
+
+        if (integrator == Integrator::VELOCITY_VERLET && stage == 0)
+        {
+            // Full position step from the start acceleration, velocity predicted for velocity-dependent forces
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const float acceleration = force[i] * inv_mass[i];
+                accumulator[i] = acceleration;
+                position[i] = start_position[i] + (start_velocity[i] + 0.5f * acceleration * dt) * dt;
+                velocity[i] = start_velocity[i] + acceleration * dt;
+            }
+        }
+        else if (integrator == Integrator::VELOCITY_VERLET)
+        {
+            // Velocity from the mean of the start and end accelerations
+            for (std::size_t i = begin; i < end; ++i)
+                velocity[i] = start_velocity[i] + 0.5f * (accumulator[i] + force[i] * inv_mass[i]) * dt;
+        }
+        else
+        {
+            const float weight = RK4_WEIGHTS[stage];
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                const float acceleration = force[i] * inv_mass[i];
+                accumulator[i] += weight * velocity[i];
+                velocity_accumulator[i] += weight * acceleration;
+
+                // Next stage starts from the step start, moved along the derivatives just evaluated
+                const float offset = last ? 0.0f : RK4_OFFSETS[stage] * dt;
+                const float next_position = start_position[i] + offset * velocity[i];
+                velocity[i] = start_velocity[i] + offset * acceleration;
+                position[i] = next_position;
+            }
+
+            if (last)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    position[i] = start_position[i] + dt / 6.0f * accumulator[i];
+                    velocity[i] = start_velocity[i] + dt / 6.0f * velocity_accumulator[i];
+                }
+            }
+        }
+
+        // The next evaluation starts from the constant forces
+        for (std::size_t i = begin; i < end; ++i)
+            force[i] = last ? 0.0f : base_force[i];
+    }
+}
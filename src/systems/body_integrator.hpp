@@ -0,0 +1,315 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Instruction sets the body integrator can use, from narrowest to widest
+enum class SimdLevel
+{
+    SCALAR,
+    SSE,
+    AVX2,
+    AVX512,
+};
+
+// Get the widest instruction set supported by the CPU and enabled by the OS, checked with CPUID
+[[nodiscard]] SimdLevel detect_simd_level() noexcept;
+
+/*
+Get the name of an instruction set, for logs
+@param level: Instruction set
+*/
+[[nodiscard]] const char *get_simd_level_name(const SimdLevel level) noexcept;
+
+// Schemes integrating linear motion, angular motion always uses semi-implicit Euler
+enum class Integrator
+{
+    // First order, one force evaluation per step, keeps energy bounded on oscillating systems
+    SYMPLECTIC_EULER,
+    // Second order, two force evaluations per step
+    VELOCITY_VERLET,
+    // Fourth order, four force evaluations per step, slowly loses energy
+    RK4,
+};
+
+/*
+Get the name of an integrator, for logs
+@param integrator: Integrator
+*/
+[[nodiscard]] const char *get_integrator_name(const Integrator integrator) noexcept;
+
+// Size of a cache line, arrays of bodies start on one
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// Bodies in a cache line of each array, ranges of bodies given to different threads are multiples of it so they never share a line
+constexpr std::size_t BODIES_PER_CACHE_LINE = CACHE_LINE_SIZE / sizeof(float);
+
+// Allocator aligning arrays on cache lines
+template <typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    CacheAlignedAllocator() noexcept = default;
+
+    template <typename U>
+    CacheAlignedAllocator([[maybe_unused]] const CacheAlignedAllocator<U> &other) noexcept
+    {
+    }
+
+    [[nodiscard]] T *allocate(const std::size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+    }
+
+    void deallocate(T *pointer, [[maybe_unused]] const std::size_t count) noexcept
+    {
+        ::operator delete(pointer, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    template <typename U>
+    [[nodiscard]] bool operator==([[maybe_unused]] const CacheAlignedAllocator<U> &other) const noexcept { return true; }
+
+    template <typename U>
+    [[nodiscard]] bool operator!=([[maybe_unused]] const CacheAlignedAllocator<U> &other) const noexcept { return false; }
+};
+
+// Array of one scalar of every body
+using BodyArray = std::vector<float, CacheAlignedAllocator<float>>;
+
+/*
+Rigid body state in SoA layout, one array per scalar so SIMD lanes load consecutive bodies
+Orientations are stored as x, y, z, w
+Inverse inertia tensors are diagonal in local space, the world tensor R * I^-1 * R^T is applied on the fly
+Every array is aligned on a cache line
+*/
+struct BodyBatch
+{
+    std::array<BodyArray, 3> position;
+    std::array<BodyArray, 3> linear_velocity;
+    std::array<BodyArray, 3> force;
+    BodyArray inv_mass;
+    std::array<BodyArray, 3> angular_velocity;
+    std::array<BodyArray, 3> torque;
+    std::array<BodyArray, 4> orientation;
+    std::array<BodyArray, 3> inv_inertia;
+
+    // Intermediate states of the multi-stage integrators, kept between steps to reuse their capacity
+    std::array<BodyArray, 15> stages;
+
+    // Remove every body, capacity is kept
+    void clear() noexcept;
+
+    /*
+    Append a body
+    @param position: Position
+    @param linear_velocity: Linear velocity
+    @param force: Accumulated force
+    @param inv_mass: Inverse mass
+    @param angular_velocity: Angular velocity
+    @param torque: Accumulated torque
+    @param orientation: Unit quaternion, from local to world space
+    @param inv_inertia: Diagonal of the inverse inertia tensor, in local space
+    */
+    void push_back(const glm::vec3 &position, const glm::vec3 &linear_velocity, const glm::vec3 &force, const float inv_mass,
+                   const glm::vec3 &angular_velocity, const glm::vec3 &torque, const glm::quat &orientation, const glm::vec3 &inv_inertia);
+
+    /*
+    Set the number of bodies, new bodies must then be written with set
+    @param count: Number of bodies
+    */
+    void resize(const std::size_t count);
+
+    /*
+    Overwrite a body, bodies can be written from several threads
+    @param index: Body's index
+    @param position: Position
+    @param linear_velocity: Linear velocity
+    @param force: Accumulated force
+    @param inv_mass: Inverse mass
+    @param angular_velocity: Angular velocity
+    @param torque: Accumulated torque
+    @param orientation: Unit quaternion, from local to world space
+    @param inv_inertia: Diagonal of the inverse inertia tensor, in local space
+    */
+    void set(const std::size_t index, const glm::vec3 &position, const glm::vec3 &linear_velocity, const glm::vec3 &force, const float inv_mass,
+             const glm::vec3 &angular_velocity, const glm::vec3 &torque, const glm::quat &orientation, const glm::vec3 &inv_inertia) noexcept;
+
+    // Number of bodies
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /*
+    Get the position of a body
+    @param index: Body's index
+    */
+    [[nodiscard]] glm::vec3 get_position(const std::size_t index) const noexcept;
+
+    /*
+    Get the linear velocity of a body
+    @param index: Body's index
+    */
+    [[nodiscard]] glm::vec3 get_linear_velocity(const std::size_t index) const noexcept;
+
+    /*
+    Get the angular velocity of a body
+    @param index: Body's index
+    */
+    [[nodiscard]] glm::vec3 get_angular_velocity(const std::size_t index) const noexcept;
+
+    /*
+    Get the orientation of a body
+    @param index: Body's index
+    */
+    [[nodiscard]] glm::quat get_orientation(const std::size_t index) const noexcept;
+};
+
+/*
+Integrate velocities, positions and orientations of every body over a step, then clear forces and torques
+Semi-implicit Euler: velocities first, positions and orientations from the new velocities
+Every path performs the same operations in the same order, without fused multiply-add
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+*/
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level) noexcept;
+
+/*
+Integrate velocities, positions and orientations of a range of bodies over a step, then clear their forces and torques
+Results do not depend on the range, ranges can run in parallel
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+@param begin: First body
+@param end: One past the last body
+*/
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level, const std::size_t begin, const std::size_t end) noexcept;
+
+/*
+Integrate angular velocities and orientations of every body over a step, then clear torques
+Linear motion is left to the caller, for the multi-stage integrators
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+*/
+void integrate_angular(BodyBatch &bodies, const float dt, const SimdLevel level) noexcept;
+
+/*
+Integrate angular velocities and orientations of a range of bodies over a step, then clear their torques
+@param bodies: Bodies to integrate
+@param dt: Delta time
+@param level: Instruction set to use, must be supported by the CPU
+@param begin: First body
+@param end: One past the last body
+*/
+void integrate_angular(BodyBatch &bodies, const float dt, const SimdLevel level, const std::size_t begin, const std::size_t end) noexcept;
+
+/*
+Get the number of force evaluations of an integrator in a step
+@param integrator: Integrator
+*/
+[[nodiscard]] unsigned get_stage_count(const Integrator integrator) noexcept;
+
+/*
+Save the state at the start of a step for a multi-stage integrator, forces must hold the constant forces only
+@param bodies: Bodies to integrate
+*/
+void begin_stages(BodyBatch &bodies);
+
+/*
+Size the stage arrays of a multi-stage integrator, before saving the start of a step range by range
+@param bodies: Bodies to integrate
+*/
+void resize_stages(BodyBatch &bodies);
+
+/*
+Save the state of a range of bodies at the start of a step, the stage arrays must be sized
+@param bodies: Bodies to integrate
+@param begin: First body
+@param end: One past the last body
+*/
+void begin_stages(BodyBatch &bodies, const std::size_t begin, const std::size_t end) noexcept;
+
+/*
+Consume the forces evaluated for a stage and move the bodies to the state of the next one
+Returns false after the last stage, linear motion is then integrated and forces are cleared
+@param bodies: Bodies to integrate
+@param integrator: VELOCITY_VERLET or RK4
+@param stage: Index of the stage, from 0
+@param dt: Delta time
+*/
+bool advance_stage(BodyBatch &bodies, const Integrator integrator, const unsigned stage, const float dt) noexcept;
+
+/*
+Consume the forces evaluated for a stage and move a range of bodies to the state of the next one
+@param bodies: Bodies to integrate
+@param integrator: VELOCITY_VERLET or RK4
+@param stage: Index of the stage, from 0
+@param dt: Delta time
+@param begin: First body
+@param end: One past the last body
+*/
+void advance_stage(BodyBatch &bodies, const Integrator integrator, const unsigned stage, const float dt,
+                   const std::size_t begin, const std::size_t end) noexcept;
+
+/*
+Integrate every body over a step with a chosen scheme, then clear forces and torques
+Bodies are processed in ranges that may run in parallel, results do not depend on how they are split
+@param bodies: Bodies to integrate, forces hold the forces that stay constant over the step
+@param dt: Delta time
+@param level: Instruction set of the angular motion and of semi-implicit Euler, must be supported by the CPU
+@param integrator: Scheme of the linear motion
+@param compute_forces: Called with the bodies once per stage, adds the forces at their current positions and velocities
+@param parallel_for: Called with a body count and a function, calls the function on ranges [begin, end) covering every body and returns once all are done
+*/
+template <typename ComputeForces, typename ParallelFor>
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level, const Integrator integrator, ComputeForces &&compute_forces,
+                      ParallelFor &&parallel_for)
+{
+    const std::size_t count = bodies.size();
+    if (integrator == Integrator::SYMPLECTIC_EULER)
+    {
+        compute_forces(bodies);
+        parallel_for(count, [&bodies, dt, level](const std::size_t begin, const std::size_t end)
+                     { integrate_bodies(bodies, dt, level, begin, end); });
+        return;
+    }
+
+    resize_stages(bodies);
+    parallel_for(count, [&bodies](const std::size_t begin, const std::size_t end)
+                 { begin_stages(bodies, begin, end); });
+
+    const unsigned stages = get_stage_count(integrator);
+    for (unsigned stage = 0; stage < stages; ++stage)
+    {
+        compute_forces(bodies);
+        parallel_for(count, [&bodies, integrator, stage, dt](const std::size_t begin, const std::size_t end)
+                     { advance_stage(bodies, integrator, stage, dt, begin, end); });
+    }
+
+    parallel_for(count, [&bodies, dt, level](const std::size_t begin, const std::size_t end)
+                 { integrate_angular(bodies, dt, level, begin, end); });
+}
+
+/*
+Integrate every body over a step with a chosen scheme on the calling thread, then clear forces and torques
+@param bodies: Bodies to integrate, forces hold the forces that stay constant over the step
+@param dt: Delta time
+@param level: Instruction set of the angular motion and of semi-implicit Euler, must be supported by the CPU
+@param integrator: Scheme of the linear motion
+@param compute_forces: Called with the bodies once per stage, adds the forces at their current positions and velocities
+*/
+template <typename ComputeForces>
+void integrate_bodies(BodyBatch &bodies, const float dt, const SimdLevel level, const Integrator integrator, ComputeForces &&compute_forces)
+{
+    integrate_bodies(bodies, dt, level, integrator, std::forward<ComputeForces>(compute_forces),
+                     [](const std::size_t count, auto &&range)
+                     { range(std::size_t(0), count); });
+}
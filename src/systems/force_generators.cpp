@@ -0,0 +1,259 @@
+#include "force_generators.hpp"
+
+/*
+Add a uniform gravity, returns INVALID_FORCE_GENERATOR if every id is used
+@param gravity: Gravity parameters
+*/
+ForceGeneratorId ForceRegistry::add_gravity(const GravityForce &gravity)
+{
+    const ForceGeneratorId id = allocate_id();
+    if (id != INVALID_FORCE_GENERATOR)
+    {
+        gravities_.push_back({id, gravity});
+        changed_ |= get_force_mask(id);
+    }
+    return id;
+}
+
+/*
+Add a drag, returns INVALID_FORCE_GENERATOR if every id is used
+@param drag: Drag parameters
+*/
+ForceGeneratorId ForceRegistry::add_drag(const DragForce &drag)
+{
+    const ForceGeneratorId id = allocate_id();
+    if (id != INVALID_FORCE_GENERATOR)
+    {
+        drags_.push_back({id, drag});
+        changed_ |= get_force_mask(id);
+    }
+    return id;
+}
+
+/*
+Add a point attractor, returns INVALID_FORCE_GENERATOR if every id is used
+@param attractor: Attractor parameters
+*/
+ForceGeneratorId ForceRegistry::add_attractor(const AttractorForce &attractor)
+{
+    const ForceGeneratorId id = allocate_id();
+    if (id != INVALID_FORCE_GENERATOR)
+    {
+        attractors_.push_back({id, attractor});
+        changed_ |= get_force_mask(id);
+    }
+    return id;
+}
+
+/*
+Remove a field generator, its id can then be reused
+@param id: Force generator
+*/
+void ForceRegistry::remove(const ForceGeneratorId id)
+{
+    if (erase(gravities_, id) || erase(drags_, id) || erase(attractors_, id))
+    {
+        used_ &= ~get_force_mask(id);
+        changed_ |= get_force_mask(id);
+    }
+}
+
+/*
+Get the parameters of a gravity, nullptr if the id is not a gravity
+The generator is recorded as changed, the parameters may be written through the pointer
+@param id: Force generator
+*/
+[[nodiscard]] GravityForce *ForceRegistry::get_gravity(const ForceGeneratorId id) noexcept
+{
+    GravityForce *force = find(gravities_, id);
+    if (force != nullptr)
+        changed_ |= get_force_mask(id);
+    return force;
+}
+
+/*
+Get the parameters of a drag, nullptr if the id is not a drag
+The generator is recorded as changed, the parameters may be written through the pointer
+@param id: Force generator
+*/
+[[nodiscard]] DragForce *ForceRegistry::get_drag(const ForceGeneratorId id) noexcept
+{
+    DragForce *force = find(drags_, id);
+    if (force != nullptr)
+        changed_ |= get_force_mask(id);
+    return force;
+}
+
+/*
+Get the parameters of an attractor, nullptr if the id is not an attractor
+The generator is recorded as changed, the parameters may be written through the pointer
+@param id: Force generator
+*/
+[[nodiscard]] AttractorForce *ForceRegistry::get_attractor(const ForceGeneratorId id) noexcept
+{
+    AttractorForce *force = find(attractors_, id);
+    if (force != nullptr)
+        changed_ |= get_force_mask(id);
+    return force;
+}
+
+/*
+Add a spring, returns its index
+@param spring: Spring parameters
+*/
+std::size_t ForceRegistry::add_spring(const Spring &spring)
+{
+    springs_.push_back(spring);
+    changed_endpoints_.push_back(spring.first);
+    changed_endpoints_.push_back(spring.second);
+    return springs_.size() - 1;
+}
+
+/*
+Remove a spring, the last spring takes its index
+@param index: Spring's index
+*/
+void ForceRegistry::remove_spring(const std::size_t index)
+{
+    if (index >= springs_.size())
+        return;
+
+    changed_endpoints_.push_back(springs_[index].first);
+    changed_endpoints_.push_back(springs_[index].second);
+    springs_[index] = springs_.back();
+    springs_.pop_back();
+}
+
+// Get every spring
+[[nodiscard]] const std::vector<Spring> &ForceRegistry::get_springs() const noexcept
+{
+    return springs_;
+}
+
+// Get every spring, bodies linked by a spring written through the reference must be woken up with PhysicsSystem::wake_up
+[[nodiscard]] std::vector<Spring> &ForceRegistry::get_springs() noexcept
+{
+    return springs_;
+}
+
+/*
+Record a field generator as changed, for parameters written through a pointer kept from an earlier get
+@param id: Force generator
+*/
+void ForceRegistry::mark_changed(const ForceGeneratorId id) noexcept
+{
+    changed_ |= get_force_mask(id) & used_;
+}
+
+// Get the field generators added, removed or changed since the last clear_changes
+[[nodiscard]] ForceMask ForceRegistry::get_changed_generators() const noexcept
+{
+    return changed_;
+}
+
+// Get the endpoints of the springs added or removed since the last clear_changes
+[[nodiscard]] const std::vector<Entity> &ForceRegistry::get_changed_endpoints() const noexcept
+{
+    return changed_endpoints_;
+}
+
+// Forget the recorded changes
+void ForceRegistry::clear_changes() noexcept
+{
+    changed_ = 0;
+    changed_endpoints_.clear();
+}
+
+/*
+Add the forces of the field generators to the bodies, each body only receives the generators of its mask
+@param bodies: Gathered bodies
+@param masks: Force mask of each body
+*/
+void ForceRegistry::apply(BodyBatch &bodies, const std::vector<ForceMask> &masks) const noexcept
+{
+    apply(bodies, masks, 0, bodies.size());
+}
+
+/*
+Add the forces of the field generators to a range of bodies, ranges can run in parallel
+@param bodies: Gathered bodies
+@param masks: Force mask of each body
+@param begin: First body
+@param end: One past the last body
+*/
+void ForceRegistry::apply(BodyBatch &bodies, const std::vector<ForceMask> &masks, const std::size_t begin, const std::size_t end) const noexcept
+{
+    const ForceMask *body_masks = masks.data();
+    const float *inv_mass = bodies.inv_mass.data();
+    const float *position[3] = {bodies.position[0].data(), bodies.position[1].data(), bodies.position[2].data()};
+    const float *velocity[3] = {bodies.linear_velocity[0].data(), bodies.linear_velocity[1].data(), bodies.linear_velocity[2].data()};
+    float *force[3] = {bodies.force[0].data(), bodies.force[1].data(), bodies.force[2].data()};
+
+    // Loops are branchless so they vectorize, bodies without the generator's bit get a zero weight
+    for (const Entry<GravityForce> &entry : gravities_)
+    {
+        const ForceMask bit = get_force_mask(entry.id);
+        const glm::vec3 acceleration = entry.force.acceleration;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float mass = inv_mass[i] > 0.0f ? 1.0f / inv_mass[i] : 0.0f;
+            const float weight = (body_masks[i] & bit) != 0 ? mass : 0.0f;
+            force[0][i] += acceleration.x * weight;
+            force[1][i] += acceleration.y * weight;
+            force[2][i] += acceleration.z * weight;
+        }
+    }
+
+    for (const Entry<DragForce> &entry : drags_)
+    {
+        const ForceMask bit = get_force_mask(entry.id);
+        const DragForce drag = entry.force;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float speed = std::sqrt(velocity[0][i] * velocity[0][i] + velocity[1][i] * velocity[1][i] + velocity[2][i] * velocity[2][i]);
+            const float coefficient = drag.linear + drag.quadratic * speed;
+            const float weight = (body_masks[i] & bit) != 0 ? coefficient : 0.0f;
+            force[0][i] -= velocity[0][i] * weight;
+            force[1][i] -= velocity[1][i] * weight;
+            force[2][i] -= velocity[2][i] * weight;
+        }
+    }
+
+    for (const Entry<AttractorForce> &entry : attractors_)
+    {
+        const ForceMask bit = get_force_mask(entry.id);
+        const AttractorForce attractor = entry.force;
+        const float softening = attractor.softening * attractor.softening;
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float dx = attractor.position.x - position[0][i];
+            const float dy = attractor.position.y - position[1][i];
+            const float dz = attractor.position.z - position[2][i];
+            const float distance_squared = dx * dx + dy * dy + dz * dz + softening;
+            const float mass = inv_mass[i] > 0.0f ? 1.0f / inv_mass[i] : 0.0f;
+
+            // strength / d^2 along the unit direction d / |d|
+            const float magnitude = attractor.strength * mass / (distance_squared * std::sqrt(distance_squared));
+            const float weight = (body_masks[i] & bit) != 0 && distance_squared > 0.0f ? magnitude : 0.0f;
+            force[0][i] += dx * weight;
+            force[1][i] += dy * weight;
+            force[2][i] += dz * weight;
+        }
+    }
+}
+
+// Reserve the lowest free id, INVALID_FORCE_GENERATOR if every id is used
+[[nodiscard]] ForceGeneratorId ForceRegistry::allocate_id()
+{
+    for (ForceGeneratorId id = 0; id < MAX_FORCE_GENERATORS; ++id)
+    {
+        if ((used_ & get_force_mask(id)) == 0)
+        {
+            used_ |= get_force_mask(id);
+            return id;
+        }
+    }
+
+    std::cerr << "[PHYSICS SYSTEM WARNING] Every force generator id is used\n";
+    return INVALID_FORCE_GENERATOR;
+}
\ No newline at end of file
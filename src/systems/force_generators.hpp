@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "body_integrator.hpp"
+#include "components.hpp"
+#include "entity.hpp"
+
+// Identifies a force generator, it applies to the entities whose force mask has the bit of the same index
+using ForceGeneratorId = unsigned;
+
+constexpr ForceGeneratorId MAX_FORCE_GENERATORS = sizeof(ForceMask) * 8;
+constexpr ForceGeneratorId INVALID_FORCE_GENERATOR = ~0u;
+
+/*
+Get the bit selecting a force generator in a ForceMask
+@param id: Force generator
+*/
+[[nodiscard]] constexpr ForceMask get_force_mask(const ForceGeneratorId id) noexcept
+{
+    return id < MAX_FORCE_GENERATORS ? ForceMask(1) << id : ForceMask(0);
+}
+
+/*
+Uniform acceleration, the force is scaled by each body's mass
+@param acceleration: Acceleration in world space
+*/
+struct GravityForce
+{
+    glm::vec3 acceleration{0.0f, -9.81f, 0.0f};
+};
+
+/*
+Force opposed to the velocity, F = -(linear + quadratic * |v|) * v
+@param linear: Linear coefficient, dominates at low speeds
+@param quadratic: Quadratic coefficient, dominates at high speeds
+*/
+struct DragForce
+{
+    float linear = 0.1f;
+    float quadratic = 0.0f;
+};
+
+/*
+Pull toward a point, falling with the square of the distance, the force is scaled by each body's mass
+@param position: Attracting point
+@param strength: Acceleration at one unit of distance
+@param softening: Added to the distance so bodies close to the point stay stable
+*/
+struct AttractorForce
+{
+    glm::vec3 position{0.0f, 0.0f, 0.0f};
+    float strength = 1.0f;
+    float softening = 0.1f;
+};
+
+/*
+Damped spring between two entities, pulls them together when longer than its rest length
+Endpoints that are not integrated (static, sleeping, disabled) act as fixed anchors
+@param first: First endpoint
+@param second: Second endpoint
+@param rest_length: Length without tension
+@param stiffness: Force per unit of stretch
+@param damping: Force per unit of relative velocity along the spring
+*/
+struct Spring
+{
+    Entity first = NULL_ENTITY;
+    Entity second = NULL_ENTITY;
+    float rest_length = 1.0f;
+    float stiffness = 10.0f;
+    float damping = 0.5f;
+};
+
+/*
+Registry of the force generators of a scene, applied to the gathered bodies in one pass per generator
+Field generators (gravity, drag, attractors) are selected per entity through PhysicsPropertiesComponent::force_mask
+Springs link two entities and always apply
+Changes are recorded so the PhysicsSystem wakes the sleeping bodies they affect
+*/
+class ForceRegistry
+{
+public:
+    /*
+    Add a uniform gravity, returns INVALID_FORCE_GENERATOR if every id is used
+    @param gravity: Gravity parameters
+    */
+    ForceGeneratorId add_gravity(const GravityForce &gravity);
+
+    /*
+    Add a drag, returns INVALID_FORCE_GENERATOR if every id is used
+    @param drag: Drag parameters
+    */
+    ForceGeneratorId add_drag(const DragForce &drag);
+
+    /*
+    Add a point attractor, returns INVALID_FORCE_GENERATOR if every id is used
+    @param attractor: Attractor parameters
+    */
+    ForceGeneratorId add_attractor(const AttractorForce &attractor);
+
+    /*
+    Remove a field generator, its id can then be reused
+    @param id: Force generator
+    */
+    void remove(const ForceGeneratorId id);
+
+    /*
+    Get the parameters of a gravity, nullptr if the id is not a gravity
+    The generator is recorded as changed, the parameters may be written through the pointer
+    @param id: Force generator
+    */
+    [[nodiscard]] GravityForce *get_gravity(const ForceGeneratorId id) noexcept;
+
+    /*
+    Get the parameters of a drag, nullptr if the id is not a drag
+    The generator is recorded as changed, the parameters may be written through the pointer
+    @param id: Force generator
+    */
+    [[nodiscard]] DragForce *get_drag(const ForceGeneratorId id) noexcept;
+
+    /*
+    Get the parameters of an attractor, nullptr if the id is not an attractor
+    The generator is recorded as changed, the parameters may be written through the pointer
+    @param id: Force generator
+    */
+    [[nodiscard]] AttractorForce *get_attractor(const ForceGeneratorId id) noexcept;
+
+    /*
+    Add a spring, returns its index
+    @param spring: Spring parameters
+    */
+    std::size_t add_spring(const Spring &spring);
+
+    /*
+    Remove a spring, the last spring takes its index
+    @param index: Spring's index
+    */
+    void remove_spring(const std::size_t index);
+
+    // Get every spring
+    [[nodiscard]] const std::vector<Spring> &get_springs() const noexcept;
+
+    // Get every spring, bodies linked by a spring written through the reference must be woken up with PhysicsSystem::wake_up
+    [[nodiscard]] std::vector<Spring> &get_springs() noexcept;
+
+    /*
+    Record a field generator as changed, for parameters written through a pointer kept from an earlier get
+    @param id: Force generator
+    */
+    void mark_changed(const ForceGeneratorId id) noexcept;
+
+    // Get the field generators added, removed or changed since the last clear_changes
+    [[nodiscard]] ForceMask get_changed_generators() const noexcept;
+
+    // Get the endpoints of the springs added or removed since the last clear_changes
+    [[nodiscard]] const std::vector<Entity> &get_changed_endpoints() const noexcept;
+
+    // Forget the recorded changes
+    void clear_changes() noexcept;
+
+    /*
+    Add the forces of the field generators to the bodies, each body only receives the generators of its mask
+    @param bodies: Gathered bodies
+    @param masks: Force mask of each body
+    */
+    void apply(BodyBatch &bodies, const std::vector<ForceMask> &masks) const noexcept;
+
+    /*
+    Add the forces of the field generators to a range of bodies, ranges can run in parallel
+    @param bodies: Gathered bodies
+    @param masks: Force mask of each body
+    @param begin: First body
+    @param end: One past the last body
+    */
+    void apply(BodyBatch &bodies, const std::vector<ForceMask> &masks, const std::size_t begin, const std::size_t end) const noexcept;
+
+private:
+    // Generator parameters with the id that selects them
+    template <typename T>
+    struct Entry
+    {
+        ForceGeneratorId id;
+        T force;
+    };
+
+    // Ids in use
+    ForceMask used_ = 0;
+
+    // Ids added, removed or changed since the last clear_changes
+    ForceMask changed_ = 0;
+
+    // Endpoints of the springs added or removed since the last clear_changes
+    std::vector<Entity> changed_endpoints_;
+
+    std::vector<Entry<GravityForce>> gravities_;
+    std::vector<Entry<DragForce>> drags_;
+    std::vector<Entry<AttractorForce>> attractors_;
+    std::vector<Spring> springs_;
+
+    // Reserve the lowest free id, INVALID_FORCE_GENERATOR if every id is used
+    [[nodiscard]] ForceGeneratorId allocate_id();
+
+    /*
+    Find the parameters of a generator in one of the lists
+    @param entries: List to search
+    @param id: Force generator
+    */
+    template <typename T>
+    [[nodiscard]] static T *find(std::vector<Entry<T>> &entries, const ForceGeneratorId id) noexcept
+    {
+        for (Entry<T> &entry : entries)
+        {
+            if (entry.id == id)
+                return &entry.force;
+        }
+        return nullptr;
+    }
+
+    /*
+    Remove a generator from one of the lists, returns false if it was not there
+    @param entries: List to search
+    @param id: Force generator
+    */
+    template <typename T>
+    static bool erase(std::vector<Entry<T>> &entries, const ForceGeneratorId id) noexcept
+    {
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].id == id)
+            {
+                entries[i] = entries.back();
+                entries.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
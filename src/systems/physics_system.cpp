@@ -4,7 +4,11 @@
 Class that will handle the physics of objects in a scene
 @param entity_manager: Handles entity creation
 */
-PhysicsSystem::PhysicsSystem(const std::shared_ptr<EntityManager> entity_manager) : entity_manager_(entity_manager)
+PhysicsSystem::PhysicsSystem(const std::shared_ptr<EntityManager> entity_manager) : entity_manager_(entity_manager),
+                                                                                    transform_changes_(entity_manager->track_changes<TransformComponent>()),
+                                                                                    physics_changes_(entity_manager->track_changes<PhysicsComponent>()),
+                                                                                    properties_changes_(entity_manager->track_changes<PhysicsPropertiesComponent>()),
+                                                                                    collider_changes_(entity_manager->track_changes<ColliderComponent>())
 {
 }
 
@@ -14,53 +18,564 @@ Update physics
 */
 void PhysicsSystem::update(const float dt)
 {
-    auto &transform_components = entity_manager_->get_transforms();
-    auto &physics_components = entity_manager_->get_physics();
-    auto &collider_components = entity_manager_->get_colliders();
+    // Inertia and inverse mass only depend on the properties and the collider, refresh them when one was set
+    // A mass that is not positive would give an infinite or negative inverse mass, the default mass is used instead
+    const auto update_mass = [this](const Entity entity, PhysicsComponent &physics,
+                                    PhysicsPropertiesComponent &properties, const ColliderComponent &collider)
+    {
+        float mass = properties.mass;
+        if (!(mass > 0.0f) || !std::isfinite(mass))
+        {
+            std::cerr << "[PHYSICS SYSTEM WARNING] Mass of entity " << entity << " must be positive and finite, 1 is used\n";
+            mass = 1.0f;
+        }
+        physics.inv_mass = 1.0f / mass;
+        properties.inv_inertia = get_local_inverse_inertia(collider, mass);
+    };
+    for (const unsigned list : {collider_changes_, properties_changes_, physics_changes_})
+    {
+        for (const Entity entity : entity_manager_->get_changes(list))
+        {
+            PhysicsComponent *physics = entity_manager_->get_component<PhysicsComponent>(entity);
+            PhysicsPropertiesComponent *properties = entity_manager_->get_component<PhysicsPropertiesComponent>(entity);
+            const ColliderComponent *collider = entity_manager_->get_component<ColliderComponent>(entity);
+            if (physics != nullptr && properties != nullptr && collider != nullptr)
+                update_mass(entity, *physics, *properties, *collider);
+        }
+    }
+
+    wake_bodies();
+
+    // Start of the step, the TransformSystem blends from it to the end of the step
+    entity_manager_->query<const TransformComponent, PreviousTransformComponent>(Exclude<Static, Sleeping, Disabled>{}).each(
+        []([[maybe_unused]] const Entity entity, const TransformComponent &transform, PreviousTransformComponent &previous)
+        { previous = PreviousTransformComponent(transform); });
+
+    // Gather the moving bodies in SoA layout, static, sleeping and disabled bodies are never in the cached list
+    // The collider is required like in the mass refresh above, bodies without one never get their mass and inertia
+    body_entities_.clear();
+    body_transforms_.clear();
+    body_physics_.clear();
+    body_properties_.clear();
+    entity_manager_->query<TransformComponent, PhysicsComponent, const PhysicsPropertiesComponent, const ColliderComponent>(Exclude<Static, Sleeping, Disabled>{}).each(
+        [this](const Entity entity, TransformComponent &transform, PhysicsComponent &physics, const PhysicsPropertiesComponent &properties,
+               [[maybe_unused]] const ColliderComponent &collider)
+        {
+            body_entities_.push_back(entity);
+            body_transforms_.push_back(&transform);
+            body_physics_.push_back(&physics);
+            body_properties_.push_back(&properties);
+        });
+
+    if (deterministic_)
+        sort_bodies();
+
+    // Bodies are processed in ranges of whole cache lines on the worker pool, each body only depends on itself
+    if (pool_ == nullptr)
+        pool_ = std::make_shared<WorkerPool>(thread_settings_.thread_count);
+    const std::size_t count = body_entities_.size();
+    const std::size_t grain = get_grain(count);
+    const auto parallel_for = [this, grain](const std::size_t range_count, auto &&range)
+    { pool_->parallel_for(range_count, grain, range); };
+
+    bodies_.resize(count);
+    body_force_masks_.resize(count);
+    parallel_for(count, [this](const std::size_t begin, const std::size_t end)
+                 {
+                     for (std::size_t i = begin; i < end; ++i)
+                     {
+                         const TransformComponent &transform = *body_transforms_[i];
+                         const PhysicsComponent &physics = *body_physics_[i];
+                         const PhysicsPropertiesComponent &properties = *body_properties_[i];
+                         bodies_.set(i, transform.position, physics.linear_velocity, physics.forces, physics.inv_mass,
+                                     physics.angular_velocity, physics.torque, transform.orientation, properties.inv_inertia);
+                         body_force_masks_[i] = properties.force_mask;
+                     }
+                 });
+
+    // Springs find their endpoints in the batch, only the gathered entries are set
+    const bool has_springs = !forces_.get_springs().empty();
+    if (has_springs)
+    {
+        if (body_indices_.size() < entity_manager_->get_masks().size())
+            body_indices_.resize(entity_manager_->get_masks().size(), NO_BODY);
+        for (std::size_t i = 0; i < body_entities_.size(); ++i)
+            body_indices_[entity_index(body_entities_[i])] = static_cast<unsigned>(i);
+    }
+
+    // Generated forces add up with the ones written in PhysicsComponent::forces, they are evaluated again at each stage
+    // Springs write to both of their endpoints, they are applied on the calling thread
+    integrate_bodies(bodies_, dt, simd_level_, integrator_,
+                     [this, has_springs, &parallel_for](BodyBatch &stage_bodies)
+                     {
+                         parallel_for(stage_bodies.size(), [this, &stage_bodies](const std::size_t begin, const std::size_t end)
+                                      { forces_.apply(stage_bodies, body_force_masks_, begin, end); });
+                         if (has_springs)
+                             apply_springs(stage_bodies);
+                     },
+                     parallel_for);
+
+    // Each range keeps its own maximum speed, they are combined in range order so the result does not depend on the threads
+    range_speeds_.assign((count + grain - 1) / grain, 0.0f);
+    parallel_for(count, [this, grain](const std::size_t begin, const std::size_t end)
+                 {
+                     float max_speed = 0.0f;
+                     for (std::size_t i = begin; i < end; ++i)
+                     {
+                         TransformComponent &transform = *body_transforms_[i];
+                         PhysicsComponent &physics = *body_physics_[i];
+
+                         transform.position = bodies_.get_position(i);
+                         physics.linear_velocity = bodies_.get_linear_velocity(i);
+                         physics.angular_velocity = bodies_.get_angular_velocity(i);
+                         transform.orientation = bodies_.get_orientation(i);
+                         physics.forces = {0.0f, 0.0f, 0.0f};
+                         physics.torque = {0.0f, 0.0f, 0.0f};
+                         max_speed = std::max(max_speed, glm::length(physics.linear_velocity));
+                     }
+                     range_speeds_[begin / grain] = max_speed;
+                 });
+
+    max_speed_ = 0.0f;
+    for (const float max_speed : range_speeds_)
+        max_speed_ = std::max(max_speed_, max_speed);
+
+    // Change ticks are shared by the entities of an archetype chunk, they are written on the calling thread
+    for (const Entity entity : body_entities_)
+        entity_manager_->mark_changed<TransformComponent>(entity);
+
+    max_constraint_error_ = has_springs ? measure_constraint_error() : 0.0f;
+
+    if (sleep_settings_.enabled)
+        sleep_bodies(dt);
+
+    state_hash_ = deterministic_ ? hash_state() : 0;
+
+    if (has_springs)
+    {
+        for (const Entity entity : body_entities_)
+            body_indices_[entity_index(entity)] = NO_BODY;
+    }
+
+    // Every change was handled above, the ones made by this update are not for the next one
+    for (const unsigned list : {transform_changes_, physics_changes_, properties_changes_, collider_changes_})
+        entity_manager_->clear_changes(list);
+}
+
+/*
+Choose the instruction set of the integrator, clamped to what the CPU supports
+The widest supported one is used by default
+@param level: Instruction set
+*/
+void PhysicsSystem::set_simd_level(const SimdLevel level) noexcept
+{
+    const SimdLevel supported = detect_simd_level();
+    simd_level_ = static_cast<int>(level) < static_cast<int>(supported) ? level : supported;
+}
+
+// Get the instruction set used by the integrator
+[[nodiscard]] SimdLevel PhysicsSystem::get_simd_level() const noexcept
+{
+    return simd_level_;
+}
+
+// Get the force generators applied before each integration
+[[nodiscard]] ForceRegistry &PhysicsSystem::get_forces() noexcept
+{
+    return forces_;
+}
+
+/*
+Choose the scheme integrating linear motion, semi-implicit Euler by default
+@param integrator: Integrator
+*/
+void PhysicsSystem::set_integrator(const Integrator integrator) noexcept
+{
+    integrator_ = integrator;
+}
+
+// Get the scheme integrating linear motion
+[[nodiscard]] Integrator PhysicsSystem::get_integrator() const noexcept
+{
+    return integrator_;
+}
+
+/*
+Choose when resting bodies are put to sleep
+@param settings: Sleep settings
+*/
+void PhysicsSystem::set_sleep_settings(const SleepSettings &settings) noexcept
+{
+    sleep_settings_ = settings;
+}
+
+// Get when resting bodies are put to sleep
+[[nodiscard]] const SleepSettings &PhysicsSystem::get_sleep_settings() const noexcept
+{
+    return sleep_settings_;
+}
+
+/*
+Wake a body and its island up on the next update
+Needed after writing forces to a sleeping body through a reference, or after a spring endpoint stops being static or disabled
+Setting a component or marking it changed wakes it up too
+@param entity: Body to wake up
+*/
+void PhysicsSystem::wake_up(const Entity entity)
+{
+    wake_requests_.push_back(entity);
+}
+
+/*
+Choose how the work is spread over threads, results do not depend on it
+@param settings: Thread settings
+*/
+void PhysicsSystem::set_thread_settings(const ThreadSettings &settings)
+{
+    // The pool is created again on the next update
+    if (settings.thread_count != thread_settings_.thread_count)
+        pool_ = nullptr;
+    thread_settings_ = settings;
+}
+
+// Get how the work is spread over threads
+[[nodiscard]] const ThreadSettings &PhysicsSystem::get_thread_settings() const noexcept
+{
+    return thread_settings_;
+}
+
+/*
+Make updates reproducible bit for bit: bodies are integrated in entity order whatever the storage order,
+and the physics state is hashed after each update so runs can be compared step by step
+Build with DETERMINISTIC_PHYSICS for strict floating-point settings, so builds agree too
+@param deterministic: Enable the deterministic mode
+*/
+void PhysicsSystem::set_deterministic(const bool deterministic) noexcept
+{
+    deterministic_ = deterministic;
+}
+
+// Check if updates are reproducible bit for bit
+[[nodiscard]] bool PhysicsSystem::is_deterministic() const noexcept
+{
+    return deterministic_;
+}
+
+// Get the hash of the state of every integrated body after the last update, 0 when the deterministic mode is off
+[[nodiscard]] std::uint64_t PhysicsSystem::get_state_hash() const noexcept
+{
+    return state_hash_;
+}
+
+// Get the largest linear speed of a moving body after the last update
+[[nodiscard]] float PhysicsSystem::get_max_speed() const noexcept
+{
+    return max_speed_;
+}
+
+// Get the largest relative stretch of a spring with a moving endpoint after the last update
+[[nodiscard]] float PhysicsSystem::get_max_constraint_error() const noexcept
+{
+    return max_constraint_error_;
+}
+
+/*
+Get the number of bodies in each range handed to a thread
+Ranges are whole cache lines, about RANGES_PER_THREAD per thread so threads that finish early take more, and at least ThreadSettings::min_grain
+@param count: Number of bodies
+*/
+[[nodiscard]] std::size_t PhysicsSystem::get_grain(const std::size_t count) const noexcept
+{
+    const std::size_t ranges = static_cast<std::size_t>(pool_->get_thread_count()) * RANGES_PER_THREAD;
+    const std::size_t grain = std::max((count + ranges - 1) / ranges, std::max(thread_settings_.min_grain, std::size_t(1)));
+    return (grain + BODIES_PER_CACHE_LINE - 1) / BODIES_PER_CACHE_LINE * BODIES_PER_CACHE_LINE;
+}
+
+// Sort the gathered bodies by entity index, the storage order changes with removals and spatial reordering
+void PhysicsSystem::sort_bodies()
+{
+    std::vector<unsigned> order(body_entities_.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](const unsigned a, const unsigned b)
+              { return entity_index(body_entities_[a]) < entity_index(body_entities_[b]); });
+
+    permute(body_entities_, order);
+    permute(body_transforms_, order);
+    permute(body_physics_, order);
+    permute(body_properties_, order);
+}
+
+// FNV-1a hash of the state of every gathered body, in gathering order
+[[nodiscard]] std::uint64_t PhysicsSystem::hash_state() const noexcept
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto add = [&hash](const float value)
+    {
+        std::uint32_t word;
+        std::memcpy(&word, &value, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    };
+
+    for (std::size_t i = 0; i < body_entities_.size(); ++i)
+    {
+        const TransformComponent &transform = *body_transforms_[i];
+        const PhysicsComponent &physics = *body_physics_[i];
+
+        hash = (hash ^ body_entities_[i]) * 1099511628211ull;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            add(transform.position[axis]);
+            add(physics.linear_velocity[axis]);
+            add(physics.angular_velocity[axis]);
+        }
+        for (int axis = 0; axis < 4; ++axis)
+            add(transform.orientation[axis]);
+        add(physics.rest_time);
+    }
+    return hash;
+}
+
+// Wake up the requested and changed sleeping bodies, those a changed force generator applies to, and the sleeping bodies linked to awake ones
+void PhysicsSystem::wake_bodies()
+{
+    bool woke = false;
+    const auto wake = [this, &woke](const Entity entity)
+    {
+        if (!entity_manager_->has_tag<Sleeping>(entity))
+            return;
+
+        entity_manager_->remove_tag<Sleeping>(entity);
+        if (PhysicsComponent *physics = entity_manager_->get_component<PhysicsComponent>(entity))
+            physics->rest_time = 0.0f;
+        woke = true;
+    };
+
+    // Sleeping bodies are never written by the system, any change comes from outside
+    for (const unsigned list : {transform_changes_, physics_changes_})
+    {
+        for (const Entity entity : entity_manager_->get_changes(list))
+        {
+            if (entity_manager_->has_tag<Sleeping>(entity))
+                wake_requests_.push_back(entity);
+        }
+    }
 
-    for (const auto &[entity, mask] : entity_manager_->get_masks())
+    // New or changed force generators apply to the sleeping bodies they select, springs to their endpoints
+    const ForceMask changed_generators = forces_.get_changed_generators();
+    if (changed_generators != 0)
     {
-        // Check if entity has TransformComponent
-        if (!(mask & static_cast<unsigned>(ComponentType::TRANSFORM)))
+        entity_manager_->view<const PhysicsComponent, const PhysicsPropertiesComponent>().each(
+            [this, changed_generators](const Entity entity, [[maybe_unused]] const PhysicsComponent &physics,
+                                       const PhysicsPropertiesComponent &properties)
+            {
+                if ((properties.force_mask & changed_generators) != 0 && entity_manager_->has_tag<Sleeping>(entity))
+                    wake_requests_.push_back(entity);
+            });
+    }
+    for (const Entity entity : forces_.get_changed_endpoints())
+    {
+        if (entity_manager_->is_alive(entity))
+            wake_requests_.push_back(entity);
+    }
+    forces_.clear_changes();
+
+    for (const Entity entity : wake_requests_)
+        wake(entity);
+    wake_requests_.clear();
+
+    // Islands go to sleep as a whole, one can only be split by the bodies woken above
+    const std::vector<Spring> &springs = std::as_const(forces_).get_springs();
+    if (!woke || springs.empty())
+        return;
+
+    // Islands are found with a union-find over the spring endpoints, static and disabled endpoints are anchors, they link nothing
+    const auto is_body = [this](const Entity entity)
+    {
+        if (!entity_manager_->is_alive(entity))
+            return false;
+
+        const Signature mask = entity_manager_->get_entity_mask(entity);
+        return !mask.intersects(component_mask<Static, Disabled>()) && mask.test(component_id<PhysicsComponent>());
+    };
+
+    if (island_indices_.size() < entity_manager_->get_masks().size())
+        island_indices_.resize(entity_manager_->get_masks().size(), NO_BODY);
+    island_endpoints_.clear();
+    island_parents_.clear();
+    const auto get_endpoint = [this](const Entity entity)
+    {
+        unsigned &index = island_indices_[entity_index(entity)];
+        if (index == NO_BODY)
+        {
+            index = static_cast<unsigned>(island_endpoints_.size());
+            island_endpoints_.push_back(entity);
+            island_parents_.push_back(index);
+        }
+        return index;
+    };
+
+    for (const Spring &spring : springs)
+    {
+        if (is_body(spring.first) && is_body(spring.second))
+        {
+            const unsigned first = get_endpoint(spring.first);
+            island_parents_[find_island(first)] = find_island(get_endpoint(spring.second));
+        }
+    }
+
+    // island_ready_ flags the islands with an awake body here
+    island_ready_.assign(island_endpoints_.size(), 0);
+    for (std::size_t i = 0; i < island_endpoints_.size(); ++i)
+    {
+        if (!entity_manager_->has_tag<Sleeping>(island_endpoints_[i]))
+            island_ready_[find_island(static_cast<unsigned>(i))] = 1;
+    }
+
+    for (std::size_t i = 0; i < island_endpoints_.size(); ++i)
+    {
+        if (island_ready_[find_island(static_cast<unsigned>(i))])
+            wake(island_endpoints_[i]);
+        island_indices_[entity_index(island_endpoints_[i])] = NO_BODY;
+    }
+}
+
+/*
+Update the rest time of the gathered bodies and put every island that rested long enough to sleep, body_indices_ must be set
+@param dt: Delta time
+*/
+void PhysicsSystem::sleep_bodies(const float dt)
+{
+    const std::size_t count = bodies_.size();
+    const float linear_threshold = sleep_settings_.linear_threshold * sleep_settings_.linear_threshold;
+    const float angular_threshold = sleep_settings_.angular_threshold * sleep_settings_.angular_threshold;
+
+    island_parents_.resize(count);
+    island_ready_.assign(count, 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        island_parents_[i] = static_cast<unsigned>(i);
+
+        PhysicsComponent &physics = *body_physics_[i];
+        const bool resting = glm::dot(physics.linear_velocity, physics.linear_velocity) < linear_threshold &&
+                             glm::dot(physics.angular_velocity, physics.angular_velocity) < angular_threshold;
+        physics.rest_time = resting ? physics.rest_time + dt : 0.0f;
+    }
+
+    // Springs between two moving bodies join their islands, anchors do not
+    for (const Spring &spring : forces_.get_springs())
+    {
+        if (!entity_manager_->is_alive(spring.first) || !entity_manager_->is_alive(spring.second))
             continue;
 
-        // Check if entity has PhysicsComponent
-        if (!(mask & static_cast<unsigned>(ComponentType::PHYSICS)))
+        const unsigned first = body_indices_[entity_index(spring.first)];
+        const unsigned second = body_indices_[entity_index(spring.second)];
+        if (first != NO_BODY && second != NO_BODY)
+            island_parents_[find_island(first)] = find_island(second);
+    }
+
+    // One restless body keeps its whole island awake
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (body_physics_[i]->rest_time < sleep_settings_.delay)
+            island_ready_[find_island(static_cast<unsigned>(i))] = 0;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (!island_ready_[find_island(static_cast<unsigned>(i))])
             continue;
 
-        // Check if entity has ColliderComponent
-        if (!(mask & static_cast<unsigned>(ComponentType::COLLIDER)))
+        PhysicsComponent &physics = *body_physics_[i];
+        physics.linear_velocity = {0.0f, 0.0f, 0.0f};
+        physics.angular_velocity = {0.0f, 0.0f, 0.0f};
+
+        // Sleeping bodies are not blended, they must be drawn where they stopped
+        if (PreviousTransformComponent *previous = entity_manager_->get_component<PreviousTransformComponent>(body_entities_[i]))
+            *previous = PreviousTransformComponent(*body_transforms_[i]);
+        entity_manager_->add_tag<Sleeping>(body_entities_[i]);
+    }
+}
+
+/*
+Find the root of a body's island, compressing the path
+@param body: Position in island_parents_, of the gathered body or of the spring endpoint
+*/
+[[nodiscard]] unsigned PhysicsSystem::find_island(unsigned body) noexcept
+{
+    while (island_parents_[body] != body)
+    {
+        island_parents_[body] = island_parents_[island_parents_[body]];
+        body = island_parents_[body];
+    }
+    return body;
+}
+
+/*
+Add the forces of every spring to the gathered bodies, body_indices_ must be set
+@param bodies: Gathered bodies, at the state where forces are evaluated
+*/
+void PhysicsSystem::apply_springs(BodyBatch &bodies)
+{
+    for (const Spring &spring : forces_.get_springs())
+    {
+        if (!entity_manager_->is_alive(spring.first) || !entity_manager_->is_alive(spring.second))
             continue;
 
-        // Retrieve associated components
-        TransformComponent &transform = transform_components[entity];
-        PhysicsComponent &physics = physics_components[entity];
-        ColliderComponent &collider = collider_components[entity];
+        const unsigned first = body_indices_[entity_index(spring.first)];
+        const unsigned second = body_indices_[entity_index(spring.second)];
+        if (first == NO_BODY && second == NO_BODY)
+            continue;
 
-        // Check if object is static
-        if (physics.is_static)
+        // Endpoints that are not gathered are fixed anchors
+        const TransformComponent *first_transform = entity_manager_->get_component<TransformComponent>(spring.first);
+        const TransformComponent *second_transform = entity_manager_->get_component<TransformComponent>(spring.second);
+        if (first_transform == nullptr || second_transform == nullptr)
             continue;
 
-        // Else do physics
+        const glm::vec3 first_position = first == NO_BODY ? first_transform->position : bodies.get_position(first);
+        const glm::vec3 second_position = second == NO_BODY ? second_transform->position : bodies.get_position(second);
+        const glm::vec3 first_velocity = first == NO_BODY ? glm::vec3(0.0f) : bodies.get_linear_velocity(first);
+        const glm::vec3 second_velocity = second == NO_BODY ? glm::vec3(0.0f) : bodies.get_linear_velocity(second);
+        const glm::vec3 delta = second_position - first_position;
+        const float length = glm::length(delta);
+        if (length <= 0.0f)
+            continue;
 
-        // Linear motion
-        physics.linear_acceleration = physics.forces / physics.mass;
-        physics.linear_velocity += physics.linear_acceleration * dt;
-        physics.forces = {0.0f, 0.0f, 0.0f};
-        transform.position += physics.linear_velocity * dt;
+        const glm::vec3 direction = delta / length;
+        const float tension = spring.stiffness * (length - spring.rest_length) +
+                              spring.damping * glm::dot(second_velocity - first_velocity, direction);
+        const glm::vec3 force = tension * direction;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (first != NO_BODY)
+                bodies.force[axis][first] += force[axis];
+            if (second != NO_BODY)
+                bodies.force[axis][second] -= force[axis];
+        }
+    }
+}
+
+// Largest relative stretch of the springs with a gathered endpoint, body_indices_ must be set
+[[nodiscard]] float PhysicsSystem::measure_constraint_error() const
+{
+    float error = 0.0f;
+    for (const Spring &spring : forces_.get_springs())
+    {
+        if (!entity_manager_->is_alive(spring.first) || !entity_manager_->is_alive(spring.second))
+            continue;
+        if (body_indices_[entity_index(spring.first)] == NO_BODY && body_indices_[entity_index(spring.second)] == NO_BODY)
+            continue;
 
-        // Angular motion
-        physics.inv_inertia_tensor = get_inverse_inertia_tensor(collider, physics.mass);
-        physics.angular_acceleration = physics.inv_inertia_tensor * physics.torque;
-        physics.angular_velocity += physics.angular_acceleration * dt;
-        physics.torque = {0.0f, 0.0f, 0.0f};
+        const TransformComponent *first_transform = entity_manager_->get_component<TransformComponent>(spring.first);
+        const TransformComponent *second_transform = entity_manager_->get_component<TransformComponent>(spring.second);
+        if (first_transform == nullptr || second_transform == nullptr)
+            continue;
 
-        glm::quat angular_vel_quat(0.0f, physics.angular_velocity.x, physics.angular_velocity.y, physics.angular_velocity.z);
-        glm::quat orientation = glm::quat(glm::radians(transform.eulers));
-        orientation += 0.5f * angular_vel_quat * orientation * dt;
-        orientation = glm::normalize(orientation);
-        transform.eulers = glm::degrees(glm::eulerAngles(orientation));
+        // Springs without a rest length are measured in absolute units
+        const float stretch = std::abs(glm::length(second_transform->position - first_transform->position) - spring.rest_length);
+        error = std::max(error, spring.rest_length > 0.0f ? stretch / spring.rest_length : stretch);
     }
+    return error;
 }
 
 /*
@@ -73,17 +588,14 @@ glm::vec3 PhysicsSystem::get_local_cuboid_dimensions(const ColliderComponent &co
 }
 
 /*
-Retrieve the inertia matrix using a ColliderComponent
+Retrieve the inverse inertia tensor using a ColliderComponent, diagonal in local space so no inversion is needed
 @param collider: Collider component
 @param mass: Cuboid's mass
 */
-glm::mat3 PhysicsSystem::get_inverse_inertia_tensor(const ColliderComponent &collider, const float mass)
+glm::vec3 PhysicsSystem::get_local_inverse_inertia(const ColliderComponent &collider, const float mass) noexcept
 {
     const glm::vec3 dims = get_local_cuboid_dimensions(collider);
-    glm::mat3 tensor = (mass * 1.0f / 12.0f) * glm::mat3{
-        glm::vec3{dims.y * dims.y + dims.z * dims.z, 0.0f, 0.0f}, 
-        glm::vec3{0.0f, dims.x * dims.x + dims.z * dims.z, 0.0f}, 
-        glm::vec3{0.0f, 0.0f, dims.x * dims.x + dims.y * dims.y}
-    };
-    return glm::inverse(tensor);
+    return 12.0f / (mass * glm::vec3{dims.y * dims.y + dims.z * dims.z,
+                                     dims.x * dims.x + dims.z * dims.z,
+                                     dims.x * dims.x + dims.y * dims.y});
 }
\ No newline at end of file
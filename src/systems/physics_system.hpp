@@ -1,10 +1,46 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <utility>
 #include <memory>
+#include <vector>
 
 #include <glm/gtc/quaternion.hpp>
 
+#include "body_integrator.hpp"
 #include "entity_manager.hpp"
+#include "force_generators.hpp"
+#include "worker_pool.hpp"
+
+/*
+When bodies are put to sleep, a body rests while both its speeds stay below the thresholds
+@param enabled: Put resting bodies to sleep
+@param linear_threshold: Linear speed under which a body rests
+@param angular_threshold: Angular speed under which a body rests, in radians per second
+@param delay: Time every body of an island must have rested before the island sleeps
+*/
+struct SleepSettings
+{
+    bool enabled = true;
+    float linear_threshold = 0.05f;
+    float angular_threshold = 0.05f;
+    float delay = 0.5f;
+};
+
+/*
+How the PhysicsSystem spreads its work over threads
+@param thread_count: Threads updating the bodies, the calling thread included, 0 for one per hardware thread
+@param min_grain: Fewest bodies handed to a thread at once, smaller scenes stay on the calling thread
+*/
+struct ThreadSettings
+{
+    unsigned thread_count = 0;
+    std::size_t min_grain = 4096;
+};
 
 /*
 Class that will handle the physics of objects in a scene
@@ -24,9 +60,182 @@ public:
     */
     void update(const float dt);
 
+    /*
+    Choose the instruction set of the integrator, clamped to what the CPU supports
+    The widest supported one is used by default
+    @param level: Instruction set
+    */
+    void set_simd_level(const SimdLevel level) noexcept;
+
+    // Get the instruction set used by the integrator
+    [[nodiscard]] SimdLevel get_simd_level() const noexcept;
+
+    // Get the force generators applied before each integration
+    [[nodiscard]] ForceRegistry &get_forces() noexcept;
+
+    /*
+    Choose the scheme integrating linear motion, semi-implicit Euler by default
+    @param integrator: Integrator
+    */
+    void set_integrator(const Integrator integrator) noexcept;
+
+    // Get the scheme integrating linear motion
+    [[nodiscard]] Integrator get_integrator() const noexcept;
+
+    /*
+    Choose when resting bodies are put to sleep
+    @param settings: Sleep settings
+    */
+    void set_sleep_settings(const SleepSettings &settings) noexcept;
+
+    // Get when resting bodies are put to sleep
+    [[nodiscard]] const SleepSettings &get_sleep_settings() const noexcept;
+
+    /*
+    Wake a body and its island up on the next update
+    Needed after writing forces to a sleeping body through a reference, or after a spring endpoint stops being static or disabled
+    Setting a component or marking it changed wakes it up too
+    @param entity: Body to wake up
+    */
+    void wake_up(const Entity entity);
+
+    /*
+    Choose how the work is spread over threads, results do not depend on it
+    @param settings: Thread settings
+    */
+    void set_thread_settings(const ThreadSettings &settings);
+
+    // Get how the work is spread over threads
+    [[nodiscard]] const ThreadSettings &get_thread_settings() const noexcept;
+
+    /*
+    Make updates reproducible bit for bit: bodies are integrated in entity order whatever the storage order,
+    and the physics state is hashed after each update so runs can be compared step by step
+    Build with DETERMINISTIC_PHYSICS for strict floating-point settings, so builds agree too
+    @param deterministic: Enable the deterministic mode
+    */
+    void set_deterministic(const bool deterministic) noexcept;
+
+    // Check if updates are reproducible bit for bit
+    [[nodiscard]] bool is_deterministic() const noexcept;
+
+    // Get the hash of the state of every integrated body after the last update, 0 when the deterministic mode is off
+    [[nodiscard]] std::uint64_t get_state_hash() const noexcept;
+
+    // Get the largest linear speed of a moving body after the last update
+    [[nodiscard]] float get_max_speed() const noexcept;
+
+    // Get the largest relative stretch of a spring with a moving endpoint after the last update
+    [[nodiscard]] float get_max_constraint_error() const noexcept;
+
 private:
-    [[maybe_unused]] glm::vec3 gravity_{0.0f, -9.81f, 0.0f};
+    static constexpr unsigned NO_BODY = ~0u;
+
+    // Ranges of bodies per thread in a parallel loop, more ranges balance the load when a thread is preempted
+    static constexpr std::size_t RANGES_PER_THREAD = 4;
+
     std::shared_ptr<EntityManager> entity_manager_ = nullptr;
+    ForceRegistry forces_;
+
+    // Lists of the entities whose component was added or changed since the last update, see EntityManager::track_changes
+    unsigned transform_changes_ = 0;
+    unsigned physics_changes_ = 0;
+    unsigned properties_changes_ = 0;
+    unsigned collider_changes_ = 0;
+
+    SimdLevel simd_level_ = detect_simd_level();
+    Integrator integrator_ = Integrator::SYMPLECTIC_EULER;
+    SleepSettings sleep_settings_;
+    bool deterministic_ = false;
+    ThreadSettings thread_settings_;
+
+    // Created on the first update, copies of the system share it
+    std::shared_ptr<WorkerPool> pool_ = nullptr;
+    std::uint64_t state_hash_ = 0;
+
+    // Motion measured at the end of the last update, drives the adaptive time step
+    float max_speed_ = 0.0f;
+    float max_constraint_error_ = 0.0f;
+
+    // Bodies gathered in SoA layout for the integrator, kept between updates to reuse their capacity
+    BodyBatch bodies_;
+    std::vector<Entity> body_entities_;
+    std::vector<TransformComponent *> body_transforms_;
+    std::vector<PhysicsComponent *> body_physics_;
+    std::vector<const PhysicsPropertiesComponent *> body_properties_;
+    std::vector<ForceMask> body_force_masks_;
+
+    // Largest linear speed in each range of bodies of the last update
+    std::vector<float> range_speeds_;
+
+    // Position of each entity in bodies_, indexed by entity index, NO_BODY when it is not gathered
+    std::vector<unsigned> body_indices_;
+
+    // Bodies to wake up on the next update
+    std::vector<Entity> wake_requests_;
+
+    // Union-find parent of each gathered body when putting bodies to sleep, of each spring endpoint when waking them up
+    // Bodies linked by springs share an island
+    std::vector<unsigned> island_parents_;
+
+    // Spring endpoints when waking bodies up, and the position of each in it indexed by entity index, NO_BODY for the others
+    std::vector<Entity> island_endpoints_;
+    std::vector<unsigned> island_indices_;
+
+    // Set for the root of each island whose bodies all rested long enough, or that has an awake body when waking up
+    std::vector<std::uint8_t> island_ready_;
+
+    /*
+    Get the number of bodies in each range handed to a thread
+    Ranges are whole cache lines, about RANGES_PER_THREAD per thread so threads that finish early take more, and at least ThreadSettings::min_grain
+    @param count: Number of bodies
+    */
+    [[nodiscard]] std::size_t get_grain(const std::size_t count) const noexcept;
+
+    // Sort the gathered bodies by entity index, the storage order changes with removals and spatial reordering
+    void sort_bodies();
+
+    // FNV-1a hash of the state of every gathered body, in gathering order
+    [[nodiscard]] std::uint64_t hash_state() const noexcept;
+
+    /*
+    Reorder the values of the gathered bodies
+    @param values: Value of each gathered body
+    @param order: Gathered body that goes at each position
+    */
+    template <typename T>
+    static void permute(std::vector<T> &values, const std::vector<unsigned> &order)
+    {
+        std::vector<T> sorted;
+        sorted.reserve(order.size());
+        for (const unsigned body : order)
+            sorted.push_back(values[body]);
+        values.swap(sorted);
+    }
+
+    // Wake up the requested and changed sleeping bodies, those a changed force generator applies to, and the sleeping bodies linked to awake ones
+    void wake_bodies();
+
+    /*
+    Update the rest time of the gathered bodies and put every island that rested long enough to sleep, body_indices_ must be set
+    @param dt: Delta time
+    */
+    void sleep_bodies(const float dt);
+
+    /*
+    Find the root of a body's island, compressing the path
+    @param body: Position in island_parents_, of the gathered body or of the spring endpoint
+    */
+    [[nodiscard]] unsigned find_island(unsigned body) noexcept;
+
+    /*
+    Add the forces of every spring to the gathered bodies, body_indices_ must be set
+    @param bodies: Gathered bodies, at the state where forces are evaluated
+    */
+    void apply_springs(BodyBatch &bodies);
+
+    // Largest relative stretch of the springs with a gathered endpoint, body_indices_ must be set
+    [[nodiscard]] float measure_constraint_error() const;
 
     /*
     Returns the dimensions of a cuboid using its collider component, in local space
@@ -35,9 +244,9 @@ private:
     glm::vec3 get_local_cuboid_dimensions(const ColliderComponent &collider) noexcept;
 
     /*
-    Retrieve the inverse inertia matrix using a ColliderComponent
+    Retrieve the inverse inertia tensor using a ColliderComponent, diagonal in local space so no inversion is needed
     @param collider: Collider component
     @param mass: Cuboid's mass
     */
-    glm::mat3 get_inverse_inertia_tensor(const ColliderComponent &collider, const float mass);
+    glm::vec3 get_local_inverse_inertia(const ColliderComponent &collider, const float mass) noexcept;
 };
\ No newline at end of file
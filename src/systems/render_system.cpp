@@ -14,17 +14,11 @@ RenderSystem::RenderSystem(const unsigned shader,
 {
     // Make sure we use the shader to find uniforms
     glUseProgram(shader_);
-    pos_loc_ = glGetUniformLocation(shader_, "position");
-    euler_loc_ = glGetUniformLocation(shader_, "euler");
-    scale_loc_ = glGetUniformLocation(shader_, "scale");
+    model_loc_ = glGetUniformLocation(shader_, "model");
 
     // Check if uniforms are found
-    if (pos_loc_ == -1)
-        std::cerr << "[RENDER SYSTEM ERROR] Uniform \"position\" not found\n";
-    if (euler_loc_ == -1)
-        std::cerr << "[RENDER SYSTEM ERROR] Uniform \"euler\" not found\n";
-    if (scale_loc_ == -1)
-        std::cerr << "[RENDER SYSTEM ERROR] Uniform \"scale\" not found\n";
+    if (model_loc_ == -1)
+        std::cerr << "[RENDER SYSTEM ERROR] Uniform \"model\" not found\n";
 
     // Build meshes for use
     build_meshes();
@@ -39,43 +33,32 @@ const std::unordered_map<unsigned, Mesh> &RenderSystem::get_meshes() const noexc
 // Render the scene
 void RenderSystem::render()
 {
-    const auto &transform_components = entity_manager_->get_transforms();
-    const auto &render_components = entity_manager_->get_renders();
-
     // Clear screen
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Draw entities
-    for (const auto &[entity, mask] : entity_manager_->get_masks())
-    {
-        // If RenderComponent or TransformComponent does not exist, skip
-        if (!(mask & static_cast<unsigned>(ComponentType::TRANSFORM)) || !(mask & static_cast<unsigned>(ComponentType::RENDER)))
-            continue;
-
-        // Else retrieve the components
-        const TransformComponent &transform = transform_components.at(entity);
-        const RenderComponent &render = render_components.at(entity);
-
-        // If Mesh is not created, skip
-        if (meshes_.find(static_cast<unsigned>(render.object_type)) == meshes_.end())
-            continue;
+    // Draw entities, world matrices are kept up to date by the TransformSystem
+    entity_manager_->query<const WorldTransformComponent, const RenderComponent>(Exclude<Disabled>{}).each(
+        [this]([[maybe_unused]] const Entity entity, const WorldTransformComponent &world, const RenderComponent &render)
+        {
+            // If Mesh is not created, skip
+            const auto mesh_it = meshes_.find(static_cast<unsigned>(render.object_type));
+            if (mesh_it == meshes_.end())
+                return;
 
-        // Else retrieve the mesh
-        const Mesh &mesh = meshes_.at(static_cast<unsigned>(render.object_type));
+            // Else retrieve the mesh
+            const Mesh &mesh = mesh_it->second;
 
-        // Data to send to create the model matrix
-        glUniform3fv(pos_loc_, 1, glm::value_ptr(transform.position));
-        glUniform3fv(euler_loc_, 1, glm::value_ptr(glm::radians(transform.eulers)));
-        glUniform3fv(scale_loc_, 1, glm::value_ptr(transform.scale));
+            // Model matrix
+            glUniformMatrix4fv(model_loc_, 1, GL_FALSE, glm::value_ptr(world.matrix));
 
-        // // Bind mesh and texture
-        // glBindTexture(GL_TEXTURE_2D, render.material);
+            // // Bind mesh and texture
+            // glBindTexture(GL_TEXTURE_2D, render.material);
 
-        // Draw
-        glBindVertexArray(mesh.vao);
-        glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_count);
-        // glDrawElements(GL_TRIANGLES, render.vertex_count, GL_UNSIGNED_INT, 0);
-    }
+            // Draw
+            glBindVertexArray(mesh.vao);
+            glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_count);
+            // glDrawElements(GL_TRIANGLES, render.vertex_count, GL_UNSIGNED_INT, 0);
+        });
 
     // Display
     glfwSwapBuffers(window_.get());
@@ -90,9 +73,7 @@ void RenderSystem::simple_render()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Set uniforms
-    glUniform3fv(pos_loc_, 1, glm::value_ptr(glm::vec3{0.0f, 0.0f, 0.0f}));
-    glUniform3fv(euler_loc_, 1, glm::value_ptr(glm::radians(glm::vec3{0.0f, 0.0f, 0.0f})));
-    glUniform3fv(scale_loc_, 1, glm::value_ptr(glm::vec3{1.0f, 1.0f, 1.0f}));
+    glUniformMatrix4fv(model_loc_, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
 
     // Draw
     glBindVertexArray(mesh.vao);
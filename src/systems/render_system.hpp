@@ -36,9 +36,7 @@ private:
     std::shared_ptr<GLFWwindow> window_ = nullptr;
     std::shared_ptr<EntityManager> entity_manager_ = nullptr;
 
-    int pos_loc_ = 0;
-    int euler_loc_ = 0;
-    int scale_loc_ = 0;
+    int model_loc_ = 0;
 
     MeshFactory mesh_factory_;
 
@@ -0,0 +1,223 @@
+#include "transform_system.hpp"
+
+/*
+Class that keeps the world matrices of a scene up to date
+@param entity_manager: Handles entity creation
+*/
+TransformSystem::TransformSystem(const std::shared_ptr<EntityManager> entity_manager) : entity_manager_(entity_manager)
+{
+}
+
+/*
+Recompute the world matrices of every changed subtree, must not be called during iteration
+Entities with a PreviousTransformComponent are drawn between their previous and current transforms
+@param alpha: Blend factor, 0 for the previous transforms and 1 for the current ones
+*/
+void TransformSystem::update(const float alpha)
+{
+    // The renderer draws from world matrices, rendered entities created without one get it here
+    missing_world_.clear();
+    const auto collect = [this](const Entity entity, [[maybe_unused]] const auto &...components)
+    { missing_world_.push_back(entity); };
+    auto rendered = entity_manager_->view<const TransformComponent, const RenderComponent>().exclude<WorldTransformComponent>();
+    rendered.each_added<TransformComponent>(last_tick_, collect);
+    rendered.each_added<RenderComponent>(last_tick_, collect);
+    for (const Entity entity : missing_world_)
+    {
+        // Added by both passes when both components are new
+        if (entity_manager_->get_component<WorldTransformComponent>(entity) == nullptr)
+            entity_manager_->add_component(entity, WorldTransformComponent());
+    }
+
+    if (hierarchy_changed())
+        rebuild_order();
+
+    auto transforms = entity_manager_->view<const TransformComponent, WorldTransformComponent>();
+    transforms.each_changed<TransformComponent>(last_tick_, [this](const Entity entity, [[maybe_unused]] const TransformComponent &transform,
+                                                                   [[maybe_unused]] WorldTransformComponent &world)
+                                                { dirty_[positions_[entity_index(entity)]] = 1; });
+
+    // Entities moved by the last physics step change with alpha, even without a new step
+    entity_manager_->query<const TransformComponent, const PreviousTransformComponent, const WorldTransformComponent>(Exclude<Static, Sleeping, Disabled>{}).each(
+        [this](const Entity entity, const TransformComponent &transform, const PreviousTransformComponent &previous,
+               [[maybe_unused]] const WorldTransformComponent &world)
+        {
+            if (previous.position == transform.position && previous.orientation == transform.orientation)
+                return;
+
+            const unsigned position = positions_[entity_index(entity)];
+            dirty_[position] = 1;
+            blended_[position] = 1;
+        });
+
+    // Parents come first, so a dirty parent has been recomputed when its children are reached
+    for (std::size_t i = 0; i < order_.size(); ++i)
+    {
+        const unsigned parent = parents_[i];
+        if (parent != NO_PARENT && dirty_[parent])
+            dirty_[i] = 1;
+
+        if (!dirty_[i])
+            continue;
+
+        // Entities gone without a structural change being seen are skipped, their children use their last matrix
+        const Entity entity = order_[i];
+        const TransformComponent *transform = entity_manager_->get_component<TransformComponent>(entity);
+        WorldTransformComponent *world = entity_manager_->get_component<WorldTransformComponent>(entity);
+        if (transform == nullptr || world == nullptr)
+            continue;
+
+        const glm::mat4 local = blended_[i] ? get_local_matrix(blend(*transform, *entity_manager_->get_component<PreviousTransformComponent>(entity), alpha))
+                                            : get_local_matrix(*transform);
+        world_[i] = parent == NO_PARENT ? local : world_[parent] * local;
+
+        world->matrix = world_[i];
+        entity_manager_->mark_changed<WorldTransformComponent>(entity);
+    }
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+    std::fill(blended_.begin(), blended_.end(), 0);
+
+    last_tick_ = entity_manager_->advance_tick();
+}
+
+// Check if an entity was attached, detached, added or removed since the last update
+[[nodiscard]] bool TransformSystem::hierarchy_changed()
+{
+    if (!entity_manager_->get_removed<TransformComponent>().empty() ||
+        !entity_manager_->get_removed<WorldTransformComponent>().empty() ||
+        !entity_manager_->get_removed<HierarchyComponent>().empty())
+        return true;
+
+    bool changed = false;
+    const auto mark = [&changed]([[maybe_unused]] const Entity entity, [[maybe_unused]] const auto &...components)
+    { changed = true; };
+
+    auto transforms = entity_manager_->view<const TransformComponent, const WorldTransformComponent>();
+    transforms.each_added<TransformComponent>(last_tick_, mark);
+    transforms.each_added<WorldTransformComponent>(last_tick_, mark);
+    entity_manager_->view<const HierarchyComponent>().each_changed<HierarchyComponent>(last_tick_, mark);
+    return changed;
+}
+
+// Sort the entities in depth-first order, every entity becomes dirty
+void TransformSystem::rebuild_order()
+{
+    // Rebuilds only happen on structural changes, temporary buffers are fine here
+    std::vector<Entity> entities;
+    positions_.assign(entity_manager_->get_masks().size(), NO_PARENT);
+    entity_manager_->view<const TransformComponent, const WorldTransformComponent>().each(
+        [this, &entities](const Entity entity, [[maybe_unused]] const TransformComponent &transform,
+                          [[maybe_unused]] const WorldTransformComponent &world)
+        {
+            positions_[entity_index(entity)] = static_cast<unsigned>(entities.size());
+            entities.push_back(entity);
+        });
+
+    const std::size_t count = entities.size();
+
+    // Parent of each entity, as a position in entities
+    std::vector<unsigned> parents(count, NO_PARENT);
+    std::vector<unsigned> child_offsets(count + 1, 0);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const HierarchyComponent *hierarchy = entity_manager_->get_component<HierarchyComponent>(entities[i]);
+        if (hierarchy == nullptr || hierarchy->parent == entities[i] || !entity_manager_->is_alive(hierarchy->parent))
+            continue;
+
+        const unsigned parent = positions_[entity_index(hierarchy->parent)];
+        if (parent == NO_PARENT)
+            continue;
+
+        parents[i] = parent;
+        child_offsets[parent + 1]++;
+    }
+
+    // Children of each entity are stored contiguously
+    for (std::size_t i = 0; i < count; ++i)
+        child_offsets[i + 1] += child_offsets[i];
+
+    std::vector<unsigned> children(child_offsets[count]);
+    std::vector<unsigned> next_child(child_offsets.begin(), child_offsets.end() - 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (parents[i] != NO_PARENT)
+            children[next_child[parents[i]]++] = static_cast<unsigned>(i);
+    }
+
+    // Depth-first traversal from every root, new_positions doubles as the visited flag
+    order_.clear();
+    parents_.clear();
+    order_.reserve(count);
+    parents_.reserve(count);
+    std::vector<unsigned> new_positions(count, NO_PARENT);
+    std::vector<unsigned> stack;
+
+    const auto traverse = [&](const unsigned root)
+    {
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const unsigned node = stack.back();
+            stack.pop_back();
+
+            new_positions[node] = static_cast<unsigned>(order_.size());
+            order_.push_back(entities[node]);
+            parents_.push_back(node == root ? NO_PARENT : new_positions[parents[node]]);
+
+            // Pushed in reverse so children keep their relative order
+            for (unsigned c = child_offsets[node + 1]; c > child_offsets[node]; --c)
+            {
+                if (new_positions[children[c - 1]] == NO_PARENT)
+                    stack.push_back(children[c - 1]);
+            }
+        }
+    };
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (parents[i] == NO_PARENT)
+            traverse(i);
+    }
+
+    // Entities left are on a cycle, cut it at the first one met
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (new_positions[i] != NO_PARENT)
+            continue;
+
+        std::cerr << "[TRANSFORM SYSTEM WARNING] Cycle in the hierarchy, entity " << entities[i] << " is treated as a root\n";
+        traverse(i);
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+        positions_[entity_index(order_[i])] = static_cast<unsigned>(i);
+
+    world_.resize(count);
+    dirty_.assign(count, 1);
+    blended_.assign(count, 0);
+}
+
+/*
+Compute the matrix of a transform relative to its parent
+@param transform: Local transform
+*/
+[[nodiscard]] glm::mat4 TransformSystem::get_local_matrix(const TransformComponent &transform) noexcept
+{
+    const glm::mat4 translation = glm::translate(glm::mat4(1.0f), transform.position);
+    const glm::mat4 rotation = glm::mat4_cast(transform.orientation);
+    return glm::scale(translation * rotation, transform.scale);
+}
+
+/*
+Blend a transform with the one at the start of the last physics step, the scale is not blended
+@param transform: Current transform
+@param previous: Transform at the start of the last physics step
+@param alpha: Blend factor, 0 for the previous transform and 1 for the current one
+*/
+[[nodiscard]] TransformComponent TransformSystem::blend(const TransformComponent &transform, const PreviousTransformComponent &previous,
+                                                        const float alpha) noexcept
+{
+    return TransformComponent(glm::mix(previous.position, transform.position, alpha),
+                              glm::slerp(previous.orientation, transform.orientation, alpha),
+                              transform.scale);
+}
\ No newline at end of file
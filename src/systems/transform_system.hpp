@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "entity_manager.hpp"
+
+/*
+Class that keeps the world matrices of a scene up to date
+Entities with a TransformComponent and a WorldTransformComponent are kept in depth-first order,
+so parents come before their children and a subtree is contiguous
+Each update only recomputes the entities whose transform changed, and their descendants
+Entities with a TransformComponent and a RenderComponent are given a WorldTransformComponent if they have none
+@param entity_manager: Handles entity creation
+*/
+class TransformSystem
+{
+public:
+    TransformSystem() = default;
+    TransformSystem(const std::shared_ptr<EntityManager> entity_manager);
+
+    /*
+    Recompute the world matrices of every changed subtree, must not be called during iteration
+    Entities with a PreviousTransformComponent are drawn between their previous and current transforms
+    @param alpha: Blend factor, 0 for the previous transforms and 1 for the current ones
+    */
+    void update(const float alpha = 1.0f);
+
+private:
+    static constexpr unsigned NO_PARENT = ~0u;
+
+    std::shared_ptr<EntityManager> entity_manager_ = nullptr;
+
+    // Tick at the end of the last update, changes made after it are picked up by the next one
+    unsigned last_tick_ = 0;
+
+    // Entities in depth-first order
+    std::vector<Entity> order_;
+
+    // Position of each entity's parent in order_, NO_PARENT for roots
+    std::vector<unsigned> parents_;
+
+    // World matrices in depth-first order, children read their parent's from here
+    std::vector<glm::mat4> world_;
+
+    // Set when an entity must be recomputed, in depth-first order
+    std::vector<std::uint8_t> dirty_;
+
+    // Set when an entity is drawn between its previous and current transforms, in depth-first order
+    std::vector<std::uint8_t> blended_;
+
+    // Position of each entity in order_, indexed by entity index
+    std::vector<unsigned> positions_;
+
+    // Rendered entities found without a WorldTransformComponent during an update
+    std::vector<Entity> missing_world_;
+
+    // Check if an entity was attached, detached, added or removed since the last update
+    [[nodiscard]] bool hierarchy_changed();
+
+    // Sort the entities in depth-first order, every entity becomes dirty
+    void rebuild_order();
+
+    /*
+    Compute the matrix of a transform relative to its parent
+    @param transform: Local transform
+    */
+    [[nodiscard]] static glm::mat4 get_local_matrix(const TransformComponent &transform) noexcept;
+
+    /*
+    Blend a transform with the one at the start of the last physics step, the scale is not blended
+    @param transform: Current transform
+    @param previous: Transform at the start of the last physics step
+    @param alpha: Blend factor, 0 for the previous transform and 1 for the current one
+    */
+    [[nodiscard]] static TransformComponent blend(const TransformComponent &transform, const PreviousTransformComponent &previous,
+                                                  const float alpha) noexcept;
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "worker_pool.hpp"
+
+/*
+Persistent threads running parallel loops, the calling thread takes part in every loop
+Loops must be started from one thread at a time
+@param thread_count: Threads taking part in a loop, the caller included, 0 for one per hardware thread
+*/
+WorkerPool::WorkerPool(const unsigned thread_count)
+{
+    const unsigned count = thread_count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : thread_count;
+    threads_.reserve(count - 1);
+    for (unsigned i = 1; i < count; ++i)
+        threads_.emplace_back(&WorkerPool::worker, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+
+    for (std::thread &thread : threads_)
+        thread.join();
+}
+
+// Get the number of threads taking part in a loop, the caller included
+[[nodiscard]] unsigned WorkerPool::get_thread_count() const noexcept
+{
+    return static_cast<unsigned>(threads_.size()) + 1;
+}
+
+/*
+Hand a loop to the workers, take part in it and wait for it to finish
+@param count: Number of elements
+@param grain: Elements per range
+@param function: Range function
+@param context: Passed to the range function
+*/
+void WorkerPool::run(const std::size_t count, const std::size_t grain, const RangeFunction function, void *context)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        function_ = function;
+        context_ = context;
+        count_ = count;
+        grain_ = grain;
+        next_.store(0, std::memory_order_relaxed);
+        busy_ = static_cast<unsigned>(threads_.size());
+        generation_++;
+    }
+    start_.notify_all();
+
+    work();
+
+    // Workers still read the job until they report, it must outlive them
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return busy_ == 0; });
+
+    if (error_)
+    {
+        const std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Claim and run ranges until none are left, or a range throws
+void WorkerPool::work() noexcept
+{
+    try
+    {
+        while (true)
+        {
+            const std::size_t begin = next_.fetch_add(grain_, std::memory_order_relaxed);
+            if (begin >= count_)
+                return;
+
+            function_(context_, begin, std::min(begin + grain_, count_));
+        }
+    }
+    catch (...)
+    {
+        // Keep the first error for the caller, and leave no range for the other threads to claim
+        const std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_)
+            error_ = std::current_exception();
+        next_.store(count_, std::memory_order_relaxed);
+    }
+}
+
+// Loop of a worker thread, sleeps until a loop starts or the pool is destroyed
+void WorkerPool::worker()
+{
+    unsigned generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_.wait(lock, [this, generation]() { return stopping_ || generation_ != generation; });
+            if (stopping_)
+                return;
+            generation = generation_;
+        }
+
+        work();
+
+        {
+            const std::lock_guard<std::mutex> lock(mutex_);
+            if (--busy_ == 0)
+                done_.notify_one();
+        }
+    }
+}
\ No newline at end of file
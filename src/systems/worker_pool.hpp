@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+Persistent threads running parallel loops, the calling thread takes part in every loop
+Loops must be started from one thread at a time
+@param thread_count: Threads taking part in a loop, the caller included, 0 for one per hardware thread
+*/
+class WorkerPool
+{
+public:
+    WorkerPool(const unsigned thread_count = 0);
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    ~WorkerPool();
+
+    // Get the number of threads taking part in a loop, the caller included
+    [[nodiscard]] unsigned get_thread_count() const noexcept;
+
+    /*
+    Split [0, count) in ranges of grain elements claimed by every thread, returns once all are done
+    The first exception thrown by a range stops the loop and is rethrown on the caller once every thread is done
+    @param count: Number of elements
+    @param grain: Elements per range, the last range may be shorter
+    @param function: Called with the first and one past the last element of each range
+    */
+    template <typename Function>
+    void parallel_for(const std::size_t count, const std::size_t grain, Function &&function)
+    {
+        if (count == 0)
+            return;
+
+        // A single range is not worth waking the workers
+        if (threads_.empty() || count <= grain)
+        {
+            function(std::size_t(0), count);
+            return;
+        }
+
+        run(count, std::max(grain, std::size_t(1)), &call<std::remove_reference_t<Function>>, &function);
+    }
+
+private:
+    // Type-erased range function, called with its context
+    using RangeFunction = void (*)(void *context, std::size_t begin, std::size_t end);
+
+    std::vector<std::thread> threads_;
+
+    // Guards the job and the counters below, workers sleep on start_ and the caller on done_
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    RangeFunction function_ = nullptr;
+    void *context_ = nullptr;
+    std::size_t count_ = 0;
+    std::size_t grain_ = 0;
+    unsigned generation_ = 0;
+    unsigned busy_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+
+    // First element of the next range to claim, written by every thread so it starts a cache line and ends the pool
+    alignas(64) std::atomic<std::size_t> next_{0};
+
+    /*
+    Call a range function through its context
+    @param context: Function
+    @param begin: First element
+    @param end: One past the last element
+    */
+    template <typename Function>
+    static void call(void *context, const std::size_t begin, const std::size_t end)
+    {
+        (*static_cast<Function *>(context))(begin, end);
+    }
+
+    /*
+    Hand a loop to the workers, take part in it and wait for it to finish
+    @param count: Number of elements
+    @param grain: Elements per range
+    @param function: Range function
+    @param context: Passed to the range function
+    */
+    void run(const std::size_t count, const std::size_t grain, const RangeFunction function, void *context);
+
+    // Claim and run ranges until none are left, or a range throws
+    void work() noexcept;
+
+    // Loop of a worker thread, sleeps until a loop starts or the pool is destroyed
+    void worker();
+};